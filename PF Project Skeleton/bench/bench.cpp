@@ -0,0 +1,508 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+#include <sys/stat.h>
+#include "../core/simulation_state.h"
+#include "../core/simulation.h"
+#include "../core/trains.h"
+#include "../core/io.h"
+#include "../core/state_hash.h"
+#include "../core/workers.h"
+#include "../core/log.h"
+
+using namespace std;
+
+// ============================================================================
+// BENCH.CPP - Kernel and full-run benchmarks (make bench)
+// ============================================================================
+// For every level:
+//  - kernels: each tick phase is timed on copies of the state at the level's
+//    busiest tick (most active trains), after running the phases before it
+//    untimed; loadLevelFile is timed on the level file. Reported as ns/op.
+//  - run: the whole level from tick 0 (logs on, as in --bench), reported as
+//    ticks/sec and active-train ticks/sec.
+// Every figure is repeated and reported as mean / stddev / min / max, on
+// stdout and as JSON (--json, default out/bench/bench.json).
+//
+// Besides the shipped levels, synthetic levels are written to out/bench by
+// tiling complex_network.lvl N x N times (trains and switches included).
+// ============================================================================
+
+typedef chrono::steady_clock BenchClock;
+
+static double secondsSince(BenchClock::time_point start) {
+    return chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+struct BenchOptions {
+    vector<int> tiles;
+    int samples;
+    int runs;
+    int maxTicks;
+    int threads;
+    string outDir;
+    string jsonPath;
+};
+
+// ----------------------------------------------------------------------------
+// STATISTICS
+// ----------------------------------------------------------------------------
+struct Stats {
+    double mean, stddev, min, max;
+    int n;
+};
+
+static Stats summarize(const vector<double> &v) {
+    Stats s = {0.0, 0.0, 0.0, 0.0, (int)v.size()};
+    if (v.empty()) return s;
+    s.min = *min_element(v.begin(), v.end());
+    s.max = *max_element(v.begin(), v.end());
+    for (size_t i = 0; i < v.size(); i++) s.mean += v[i];
+    s.mean /= v.size();
+    if (v.size() > 1) {
+        double sq = 0.0;
+        for (size_t i = 0; i < v.size(); i++) sq += (v[i] - s.mean) * (v[i] - s.mean);
+        s.stddev = sqrt(sq / (v.size() - 1));
+    }
+    return s;
+}
+
+struct KernelResult {
+    string name;
+    int opsPerSample;
+    Stats nsPerOp;
+};
+
+struct LevelResult {
+    string name;
+    string path;
+    int rows, cols, trains, switches;
+    int peakTick, peakActive;
+    vector<KernelResult> kernels;
+
+    // Full runs
+    int ticks;
+    long long trainTicks;
+    bool complete;
+    Stats seconds, ticksPerSec, trainTicksPerSec;
+};
+
+// ----------------------------------------------------------------------------
+// HELPERS
+// ----------------------------------------------------------------------------
+static bool loadLevelContext(SimulationContext &ctx, const string &path) {
+    initializeSimulationState(ctx);
+    return loadLevelFile(ctx, path);
+}
+
+static string baseName(const string &path) {
+    size_t slash = path.find_last_of('/');
+    string name = (slash == string::npos) ? path : path.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    return (dot == string::npos) ? name : name.substr(0, dot);
+}
+
+static long fileSize(const string &path) {
+    struct stat st;
+    return (stat(path.c_str(), &st) == 0) ? (long)st.st_size : 0;
+}
+
+// Rough size of a context, used to bound how many copies one sample holds.
+static size_t contextBytes(const SimulationContext &ctx) {
+    return (size_t)ctx.grid_rows * ctx.grid_cols * 32 + (size_t)ctx.total_trains * 128 +
+           (size_t)ctx.total_switches * 96 + 4096;
+}
+
+// ----------------------------------------------------------------------------
+// SYNTHETIC LEVELS
+// ----------------------------------------------------------------------------
+// Write src tiled factor x factor times. Each copy keeps its trains (with
+// destinations moved into the copy) and its switches, renamed NAME_col_row
+// and placed with @x,y.
+static bool writeTiledLevel(const SimulationContext &src, int factor, const string &path, const string &name) {
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) {
+        cout << "Error: Cannot write " << path << "\n";
+        return false;
+    }
+    int rows = src.grid_rows * factor;
+    int cols = src.grid_cols * factor;
+    fprintf(f, "NAME:\n%s\n\nROWS:\n%d\n\nCOLS:\n%d\n\nSEED:\n%d\n\nWEATHER:\nNORMAL\n\nMAP:\n",
+            name.c_str(), rows, cols, src.simulation_seed);
+
+    string line;
+    for (int r = 0; r < rows; r++) {
+        const string &srcRow = src.grid[r % src.grid_rows];
+        line.clear();
+        for (int k = 0; k < factor; k++) line += srcRow;
+        fprintf(f, "%s\n", line.c_str());
+    }
+
+    fprintf(f, "\nSWITCHES:\n");
+    for (int ty = 0; ty < factor; ty++) {
+        for (int tx = 0; tx < factor; tx++) {
+            for (int s = 0; s < src.total_switches; s++) {
+                fprintf(f, "%s_%d_%d %s %d %d %d %d %d", src.switch_name[s].c_str(), tx, ty,
+                        src.switch_is_global[s] ? "GLOBAL" : "PER_DIR", src.switch_state[s],
+                        src.switch_k_values[s][0], src.switch_k_values[s][1],
+                        src.switch_k_values[s][2], src.switch_k_values[s][3]);
+                if (src.switch_x[s] >= 0 && src.switch_y[s] >= 0)
+                    fprintf(f, " @%d,%d", src.switch_x[s] + tx * src.grid_cols,
+                            src.switch_y[s] + ty * src.grid_rows);
+                fprintf(f, "\n");
+            }
+        }
+    }
+
+    fprintf(f, "\nTRAINS:\n");
+    for (int ty = 0; ty < factor; ty++) {
+        for (int tx = 0; tx < factor; tx++) {
+            for (int i = 0; i < src.total_trains; i++) {
+                fprintf(f, "%d %d %d %d %d\n", src.train_spawn_tick[i],
+                        src.train_dest_x[i] + tx * src.grid_cols, src.train_dest_y[i] + ty * src.grid_rows,
+                        src.train_wait[i], src.train_priority[i]);
+            }
+        }
+    }
+    return fclose(f) == 0;
+}
+
+// ----------------------------------------------------------------------------
+// KERNELS
+// ----------------------------------------------------------------------------
+enum BenchPhase {
+    PHASE_SPAWN, PHASE_ROUTES, PHASE_COLLISIONS, PHASE_MOVE, PHASE_ARRIVALS, PHASE_HASH, PHASE_LOG, PHASE_COUNT
+};
+
+static const char *PHASE_NAMES[PHASE_COUNT] = {
+    "spawnTrainsForTick", "determineAllRoutes", "detectCollisions", "moveAllTrains",
+    "checkArrivals", "updateStateHash", "logTick"
+};
+
+// Same order as simulateOneTick()
+static void runPhase(SimulationContext &ctx, int phase) {
+    switch (phase) {
+        case PHASE_SPAWN: spawnTrainsForTick(ctx); break;
+        case PHASE_ROUTES: determineAllRoutes(ctx); break;
+        case PHASE_COLLISIONS: detectCollisions(ctx); break;
+        case PHASE_MOVE: moveAllTrains(ctx); break;
+        case PHASE_ARRIVALS: checkArrivals(ctx); break;
+        case PHASE_HASH: updateStateHash(ctx); break;
+        case PHASE_LOG:
+            logTrainTrace(ctx);
+            logSwitchState(ctx);
+            logStateHash(ctx);
+            break;
+    }
+}
+
+// Advance ctx by one tick, stopping before `phase` (which is left to time).
+static void prepareTick(SimulationContext &ctx, int phase) {
+    ctx.current_tick++;
+    for (int p = 0; p < phase; p++) runPhase(ctx, p);
+}
+
+// Run from tick 0 and return the first tick with the most active trains.
+static int findPeakTick(const SimulationContext &initial, int maxTicks, int &peakActive) {
+    SimulationContext ctx(initial);
+    int peakTick = 0;
+    peakActive = 0;
+    while (ctx.current_tick < maxTicks) {
+        fastForwardIdleTicks(ctx, maxTicks - ctx.current_tick);
+        if (ctx.current_tick >= maxTicks) break;
+        simulateOneTick(ctx);
+        if (ctx.active_trains > peakActive) {
+            peakActive = ctx.active_trains;
+            peakTick = ctx.current_tick;
+        }
+        if (isSimulationComplete(ctx)) break;
+    }
+    return peakTick;
+}
+
+// Time one phase at the state `before` (the tick before the busiest one).
+static KernelResult benchPhase(const SimulationContext &before, int phase, const BenchOptions &opt) {
+    KernelResult result;
+    result.name = PHASE_NAMES[phase];
+    result.opsPerSample = (int)max((size_t)1, min((size_t)256, ((size_t)32 << 20) / contextBytes(before)));
+
+    vector<double> ns;
+    vector<SimulationContext> work;
+    for (int sample = -1; sample < opt.samples; sample++) {  // sample -1 warms up
+        work.assign(result.opsPerSample, before);
+        for (int k = 0; k < result.opsPerSample; k++) prepareTick(work[k], phase);
+
+        BenchClock::time_point start = BenchClock::now();
+        for (int k = 0; k < result.opsPerSample; k++) runPhase(work[k], phase);
+        double elapsed = secondsSince(start);
+
+        if (sample >= 0) ns.push_back(elapsed * 1e9 / result.opsPerSample);
+    }
+    result.nsPerOp = summarize(ns);
+    return result;
+}
+
+static KernelResult benchLoad(const string &path, const BenchOptions &opt) {
+    KernelResult result;
+    result.name = "loadLevelFile";
+    result.opsPerSample = (int)max(1L, min(64L, (4L << 20) / max(1L, fileSize(path))));
+
+    vector<double> ns;
+    for (int sample = -1; sample < opt.samples; sample++) {
+        double elapsed = 0.0;
+        for (int k = 0; k < result.opsPerSample; k++) {
+            SimulationContext ctx;
+            BenchClock::time_point start = BenchClock::now();
+            loadLevelContext(ctx, path);
+            elapsed += secondsSince(start);
+        }
+        if (sample >= 0) ns.push_back(elapsed * 1e9 / result.opsPerSample);
+    }
+    result.nsPerOp = summarize(ns);
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// FULL RUNS
+// ----------------------------------------------------------------------------
+static void benchRuns(const SimulationContext &initial, LevelResult &result, const BenchOptions &opt) {
+    vector<double> seconds, ticksPerSec, trainTicksPerSec;
+    for (int run = 0; run < opt.runs; run++) {
+        SimulationContext ctx(initial);
+        ctx.output_dir = opt.outDir;
+        initializeSimulation(ctx);
+
+        int ticks = 0;
+        long long trainTicks = 0;
+        BenchClock::time_point start = BenchClock::now();
+        initializeLogFiles(ctx);
+        while (ticks < opt.maxTicks) {
+            ticks += fastForwardIdleTicks(ctx, opt.maxTicks - ticks);
+            if (ticks >= opt.maxTicks) break;
+            simulateOneTick(ctx);
+            ++ticks;
+            trainTicks += ctx.active_trains;
+            if (isSimulationComplete(ctx)) break;
+        }
+        closeLogFiles(ctx);
+        double elapsed = secondsSince(start);
+
+        result.ticks = ticks;
+        result.trainTicks = trainTicks;
+        result.complete = isSimulationComplete(ctx);
+        seconds.push_back(elapsed);
+        ticksPerSec.push_back(elapsed > 0.0 ? ticks / elapsed : 0.0);
+        trainTicksPerSec.push_back(elapsed > 0.0 ? trainTicks / elapsed : 0.0);
+    }
+    result.seconds = summarize(seconds);
+    result.ticksPerSec = summarize(ticksPerSec);
+    result.trainTicksPerSec = summarize(trainTicksPerSec);
+}
+
+static bool benchLevel(const string &path, const string &name, const BenchOptions &opt, LevelResult &result) {
+    SimulationContext initial;
+    if (!loadLevelContext(initial, path)) {
+        cout << "Error: Cannot load " << path << "\n";
+        return false;
+    }
+
+    result.name = name;
+    result.path = path;
+    result.rows = initial.grid_rows;
+    result.cols = initial.grid_cols;
+    result.trains = initial.total_trains;
+    result.switches = initial.total_switches;
+    cout << "== " << name << " (" << result.rows << "x" << result.cols << ", " << result.trains
+         << " trains, " << result.switches << " switches)\n";
+
+    result.kernels.push_back(benchLoad(path, opt));
+
+    // Kernels run at the busiest tick, starting from the state just before it
+    initializeSimulation(initial);
+    result.peakTick = findPeakTick(initial, opt.maxTicks, result.peakActive);
+    if (result.peakActive > 0) {
+        SimulationContext before(initial);
+        while (before.current_tick < result.peakTick - 1) {
+            fastForwardIdleTicks(before, result.peakTick - 1 - before.current_tick);
+            if (before.current_tick < result.peakTick - 1) simulateOneTick(before);
+        }
+        before.output_dir = opt.outDir;
+        initializeLogFiles(before);
+        for (int phase = 0; phase < PHASE_COUNT; phase++) result.kernels.push_back(benchPhase(before, phase, opt));
+        closeLogFiles(before);
+    }
+
+    for (size_t k = 0; k < result.kernels.size(); k++) {
+        const KernelResult &kr = result.kernels[k];
+        printf("  %-20s %12.0f ns/op  (sd %.0f, min %.0f, max %.0f)\n", kr.name.c_str(),
+               kr.nsPerOp.mean, kr.nsPerOp.stddev, kr.nsPerOp.min, kr.nsPerOp.max);
+    }
+    if (result.peakActive > 0)
+        printf("  (phases timed at tick %d, %d active trains)\n", result.peakTick, result.peakActive);
+
+    benchRuns(initial, result, opt);
+    printf("  run: %d ticks%s, %.3f ms (sd %.3f) | %.0f ticks/sec | %.0f train-ticks/sec\n",
+           result.ticks, result.complete ? "" : " [stopped at max ticks]", result.seconds.mean * 1000.0,
+           result.seconds.stddev * 1000.0, result.ticksPerSec.mean, result.trainTicksPerSec.mean);
+    fflush(stdout);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// JSON OUTPUT
+// ----------------------------------------------------------------------------
+static string jsonString(const string &s) {
+    string out = "\"";
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '"' || s[i] == '\\') out += '\\';
+        out += s[i];
+    }
+    return out + "\"";
+}
+
+static void writeStats(FILE *f, const Stats &s) {
+    fprintf(f, "{\"mean\": %.3f, \"stddev\": %.3f, \"min\": %.3f, \"max\": %.3f, \"n\": %d}",
+            s.mean, s.stddev, s.min, s.max, s.n);
+}
+
+static bool writeJson(const string &path, const vector<LevelResult> &results, const BenchOptions &opt) {
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) {
+        cout << "Error: Cannot write " << path << "\n";
+        return false;
+    }
+    fprintf(f, "{\n  \"threads\": %d,\n  \"samples\": %d,\n  \"runs\": %d,\n  \"max_ticks\": %d,\n  \"levels\": [\n",
+            workerThreadCount(), opt.samples, opt.runs, opt.maxTicks);
+    for (size_t l = 0; l < results.size(); l++) {
+        const LevelResult &r = results[l];
+        fprintf(f, "    {\n      \"name\": %s,\n      \"path\": %s,\n", jsonString(r.name).c_str(),
+                jsonString(r.path).c_str());
+        fprintf(f, "      \"rows\": %d, \"cols\": %d, \"trains\": %d, \"switches\": %d,\n",
+                r.rows, r.cols, r.trains, r.switches);
+        fprintf(f, "      \"peak_tick\": %d, \"peak_active_trains\": %d,\n", r.peakTick, r.peakActive);
+        fprintf(f, "      \"kernels\": {\n");
+        for (size_t k = 0; k < r.kernels.size(); k++) {
+            fprintf(f, "        %s: {\"ops_per_sample\": %d, \"ns_per_op\": ", jsonString(r.kernels[k].name).c_str(),
+                    r.kernels[k].opsPerSample);
+            writeStats(f, r.kernels[k].nsPerOp);
+            fprintf(f, "}%s\n", k + 1 < r.kernels.size() ? "," : "");
+        }
+        fprintf(f, "      },\n      \"run\": {\"ticks\": %d, \"train_ticks\": %lld, \"complete\": %s,\n",
+                r.ticks, r.trainTicks, r.complete ? "true" : "false");
+        fprintf(f, "        \"seconds\": ");
+        writeStats(f, r.seconds);
+        fprintf(f, ",\n        \"ticks_per_sec\": ");
+        writeStats(f, r.ticksPerSec);
+        fprintf(f, ",\n        \"train_ticks_per_sec\": ");
+        writeStats(f, r.trainTicksPerSec);
+        fprintf(f, "}\n    }%s\n", l + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+// ----------------------------------------------------------------------------
+// MAIN
+// ----------------------------------------------------------------------------
+static void printUsage(const char *prog) {
+    cout << "Usage: " << prog << " [options] [extra_level.lvl ...]\n";
+    cout << " --samples N   timed samples per kernel (default 15)\n";
+    cout << " --runs N      full runs per level (default 5)\n";
+    cout << " --max-ticks N stop full runs after N ticks (default 10000)\n";
+    cout << " --tile N      add complex_network tiled N x N (default 8 and 32; 0 for none)\n";
+    cout << " --threads N   worker threads for the parallel phases\n";
+    cout << " --quick       3 samples, 2 runs, tile 8 only\n";
+    cout << " --json FILE   JSON output (default out/bench/bench.json)\n";
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opt;
+    opt.samples = 15;
+    opt.runs = 5;
+    opt.maxTicks = 10000;
+    opt.threads = 1;
+    opt.outDir = "out/bench";
+    bool tilesGiven = false;
+    vector<string> extra;
+
+    for (int a = 1; a < argc; a++) {
+        string arg = argv[a];
+        if (arg == "--samples" && a + 1 < argc) opt.samples = max(1, atoi(argv[++a]));
+        else if (arg == "--runs" && a + 1 < argc) opt.runs = max(1, atoi(argv[++a]));
+        else if (arg == "--max-ticks" && a + 1 < argc) opt.maxTicks = atoi(argv[++a]);
+        else if (arg == "--threads" && a + 1 < argc) opt.threads = atoi(argv[++a]);
+        else if (arg == "--json" && a + 1 < argc) opt.jsonPath = argv[++a];
+        else if (arg == "--tile" && a + 1 < argc) {
+            int n = atoi(argv[++a]);
+            if (!tilesGiven || n <= 0) opt.tiles.clear();
+            if (n > 0) opt.tiles.push_back(n);
+            tilesGiven = true;
+        } else if (arg == "--quick") {
+            opt.samples = 3;
+            opt.runs = 2;
+            if (!tilesGiven) opt.tiles.assign(1, 8);
+            tilesGiven = true;
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            extra.push_back(arg);
+        }
+    }
+    if (!tilesGiven) {
+        opt.tiles.push_back(8);
+        opt.tiles.push_back(32);
+    }
+    if (opt.jsonPath.empty()) opt.jsonPath = opt.outDir + "/bench.json";
+
+    mkdir("out", 0755);
+    mkdir(opt.outDir.c_str(), 0755);
+    log_level = LOG_LEVEL_WARN;
+    setWorkerThreads(opt.threads);
+
+    const char *shipped[] = {"easy_level", "medium_level", "hard_level", "complex_network"};
+    vector<string> paths, names;
+    for (int i = 0; i < 4; i++) {
+        paths.push_back(string("data/levels/") + shipped[i] + ".lvl");
+        names.push_back(shipped[i]);
+    }
+
+    if (!opt.tiles.empty()) {
+        SimulationContext base;
+        if (!loadLevelContext(base, "data/levels/complex_network.lvl")) {
+            cout << "Error: Cannot load data/levels/complex_network.lvl (run from the project root)\n";
+            return 1;
+        }
+        for (size_t t = 0; t < opt.tiles.size(); t++) {
+            ostringstream name;
+            name << "complex_network_x" << opt.tiles[t];
+            string path = opt.outDir + "/" + name.str() + ".lvl";
+            if (!writeTiledLevel(base, opt.tiles[t], path, name.str())) return 1;
+            paths.push_back(path);
+            names.push_back(name.str());
+        }
+    }
+    for (size_t i = 0; i < extra.size(); i++) {
+        paths.push_back(extra[i]);
+        names.push_back(baseName(extra[i]));
+    }
+
+    cout << "Switchback Rails benchmark: " << opt.samples << " samples/kernel, " << opt.runs
+         << " runs/level, " << workerThreadCount() << " thread(s)\n";
+
+    vector<LevelResult> results;
+    for (size_t i = 0; i < paths.size(); i++) {
+        LevelResult r;
+        if (benchLevel(paths[i], names[i], opt, r)) results.push_back(r);
+    }
+
+    if (!writeJson(opt.jsonPath, results, opt)) return 1;
+    cout << "Results written to " << opt.jsonPath << "\n";
+    return results.size() == paths.size() ? 0 : 1;
+}
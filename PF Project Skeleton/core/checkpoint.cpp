@@ -0,0 +1,306 @@
+#include "checkpoint.h"
+#include "io.h"
+#include "trains.h"
+#include "switches.h"
+#include "grid.h"
+#include "state_hash.h"
+#include "track_distance.h"
+#include "log.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <array>
+#include <utility>
+#include <stdint.h>
+
+using namespace std;
+
+// ============================================================================
+// CHECKPOINT.CPP - Checkpoint writer and reader
+// ============================================================================
+
+static const char CHECKPOINT_MAGIC[8] = {'S', 'R', 'C', 'H', 'K', 'P', 'T', 0};
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+// ----------------------------------------------------------------------------
+// Streams
+// ----------------------------------------------------------------------------
+// checkpointFields() lists the saved state once; it runs with a writer to
+// save and with a reader to restore, so the two can never disagree on order.
+struct CheckpointWriter {
+    vector<unsigned char> out;
+};
+
+struct CheckpointReader {
+    const unsigned char *p;
+    const unsigned char *end;
+    bool ok;
+};
+
+static void putBytes(CheckpointWriter &w, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    w.out.insert(w.out.end(), p, p + len);
+}
+
+static bool takeBytes(CheckpointReader &r, void *data, size_t len) {
+    if (!r.ok || (size_t)(r.end - r.p) < len) {
+        r.ok = false;
+        return false;
+    }
+    memcpy(data, r.p, len);
+    r.p += len;
+    return true;
+}
+
+static void field(CheckpointWriter &w, int &v) { int32_t x = v; putBytes(w, &x, 4); }
+static void field(CheckpointReader &r, int &v) { int32_t x = 0; takeBytes(r, &x, 4); v = x; }
+
+static void field(CheckpointWriter &w, unsigned int &v) { uint32_t x = v; putBytes(w, &x, 4); }
+static void field(CheckpointReader &r, unsigned int &v) { uint32_t x = 0; takeBytes(r, &x, 4); v = x; }
+
+// Element count of a vector about to be read; rejects counts the remaining
+// bytes cannot hold.
+static int takeCount(CheckpointReader &r, size_t elementBytes) {
+    int n = 0;
+    field(r, n);
+    if (n < 0 || (size_t)(r.end - r.p) / elementBytes < (size_t)n) {
+        r.ok = false;
+        return 0;
+    }
+    return n;
+}
+
+static void field(CheckpointWriter &w, vector<int> &v) {
+    int n = (int)v.size();
+    field(w, n);
+    for (int i = 0; i < n; i++) field(w, v[i]);
+}
+static void field(CheckpointReader &r, vector<int> &v) {
+    int n = takeCount(r, 4);
+    v.assign(n, 0);
+    for (int i = 0; i < n; i++) field(r, v[i]);
+}
+
+static void field(CheckpointWriter &w, vector<char> &v) {
+    int n = (int)v.size();
+    field(w, n);
+    putBytes(w, v.data(), n);
+}
+static void field(CheckpointReader &r, vector<char> &v) {
+    int n = takeCount(r, 1);
+    v.assign(n, 0);
+    takeBytes(r, v.data(), n);
+}
+
+static void field(CheckpointWriter &w, string &s) {
+    int n = (int)s.size();
+    field(w, n);
+    putBytes(w, s.data(), n);
+}
+static void field(CheckpointReader &r, string &s) {
+    int n = takeCount(r, 1);
+    s.assign(n, '\0');
+    if (n > 0) takeBytes(r, &s[0], n);
+}
+
+static void field(CheckpointWriter &w, vector<string> &v) {
+    int n = (int)v.size();
+    field(w, n);
+    for (int i = 0; i < n; i++) field(w, v[i]);
+}
+static void field(CheckpointReader &r, vector<string> &v) {
+    int n = takeCount(r, 4);
+    v.assign(n, string());
+    for (int i = 0; i < n; i++) field(r, v[i]);
+}
+
+static void field(CheckpointWriter &w, vector<array<int, 4> > &v) {
+    int n = (int)v.size();
+    field(w, n);
+    for (int i = 0; i < n; i++)
+        for (int d = 0; d < 4; d++) field(w, v[i][d]);
+}
+static void field(CheckpointReader &r, vector<array<int, 4> > &v) {
+    int n = takeCount(r, 16);
+    array<int, 4> zeros = {{0, 0, 0, 0}};
+    v.assign(n, zeros);
+    for (int i = 0; i < n; i++)
+        for (int d = 0; d < 4; d++) field(r, v[i][d]);
+}
+
+template <class Stream>
+static void checkpointFields(Stream &s, SimulationContext &ctx) {
+    // GRID (with any safety-tile edits)
+    field(s, ctx.grid_rows);
+    field(s, ctx.grid_cols);
+    field(s, ctx.grid);
+
+    // TRAINS
+    field(s, ctx.train_count);
+    field(s, ctx.total_trains);
+    field(s, ctx.train_id);
+    field(s, ctx.train_x);
+    field(s, ctx.train_y);
+    field(s, ctx.train_direction);
+    field(s, ctx.train_color);
+    field(s, ctx.train_spawn_tick);
+    field(s, ctx.train_active);
+    field(s, ctx.train_finished);
+    field(s, ctx.train_arrival_tick);
+    field(s, ctx.train_next_x);
+    field(s, ctx.train_next_y);
+    field(s, ctx.train_dest_x);
+    field(s, ctx.train_dest_y);
+    field(s, ctx.train_spawn_x);
+    field(s, ctx.train_spawn_y);
+    field(s, ctx.train_prev_x);
+    field(s, ctx.train_prev_y);
+    field(s, ctx.train_wait);
+    field(s, ctx.train_priority);
+
+    // SWITCHES
+    field(s, ctx.total_switches);
+    field(s, ctx.switch_name);
+    field(s, ctx.switch_x);
+    field(s, ctx.switch_y);
+    field(s, ctx.switch_state);
+    field(s, ctx.switch_active);
+    field(s, ctx.switch_is_global);
+    field(s, ctx.switch_k_values);
+    field(s, ctx.switch_counters);
+    field(s, ctx.switch_flip_queued);
+
+    // SPAWN TILES
+    field(s, ctx.spawn_tiles_x);
+    field(s, ctx.spawn_tiles_y);
+
+    // SIMULATION
+    field(s, ctx.current_tick);
+    field(s, ctx.simulation_seed);
+    field(s, ctx.rng_state);
+}
+
+// Array sizes must agree with the counts, and coordinates with the grid,
+// before any index is rebuilt.
+static bool checkpointConsistent(const SimulationContext &ctx) {
+    if (ctx.grid_rows < 0 || ctx.grid_cols < 0 || (int)ctx.grid.size() != ctx.grid_rows) return false;
+    for (int r = 0; r < ctx.grid_rows; r++)
+        if ((int)ctx.grid[r].size() != ctx.grid_cols) return false;
+
+    size_t t = (size_t)ctx.total_trains;
+    if (ctx.total_trains < 0 ||
+        ctx.train_id.size() != t || ctx.train_x.size() != t || ctx.train_y.size() != t ||
+        ctx.train_direction.size() != t || ctx.train_color.size() != t ||
+        ctx.train_spawn_tick.size() != t || ctx.train_active.size() != t ||
+        ctx.train_finished.size() != t || ctx.train_arrival_tick.size() != t ||
+        ctx.train_next_x.size() != t || ctx.train_next_y.size() != t ||
+        ctx.train_dest_x.size() != t || ctx.train_dest_y.size() != t ||
+        ctx.train_spawn_x.size() != t || ctx.train_spawn_y.size() != t ||
+        ctx.train_prev_x.size() != t || ctx.train_prev_y.size() != t ||
+        ctx.train_wait.size() != t || ctx.train_priority.size() != t)
+        return false;
+
+    // Active trains stand on the grid facing a routing direction; pending
+    // ones spawn on it (or have no spawn tile)
+    int rows = ctx.grid_rows, cols = ctx.grid_cols;
+    for (int i = 0; i < ctx.total_trains; i++) {
+        if (!isGridPositionOrNone(rows, cols, ctx.train_spawn_x[i], ctx.train_spawn_y[i]) ||
+            !isSaneDestination(ctx.train_dest_x[i], ctx.train_dest_y[i]))
+            return false;
+        if (!ctx.train_active[i]) continue;
+        if (!isGridPosition(rows, cols, ctx.train_x[i], ctx.train_y[i]) ||
+            ctx.train_direction[i] < 0 || ctx.train_direction[i] > 3)
+            return false;
+    }
+
+    size_t s = (size_t)ctx.total_switches;
+    if (ctx.total_switches < 0 ||
+        ctx.switch_name.size() != s || ctx.switch_x.size() != s || ctx.switch_y.size() != s ||
+        ctx.switch_state.size() != s || ctx.switch_active.size() != s ||
+        ctx.switch_is_global.size() != s || ctx.switch_k_values.size() != s ||
+        ctx.switch_counters.size() != s || ctx.switch_flip_queued.size() != s)
+        return false;
+    for (int i = 0; i < ctx.total_switches; i++) {
+        if (!isGridPositionOrNone(rows, cols, ctx.switch_x[i], ctx.switch_y[i]) ||
+            (ctx.switch_state[i] != 0 && ctx.switch_state[i] != 1))
+            return false;
+    }
+
+    if (ctx.spawn_tiles_x.size() != ctx.spawn_tiles_y.size()) return false;
+    for (size_t k = 0; k < ctx.spawn_tiles_x.size(); k++)
+        if (!isGridPosition(rows, cols, ctx.spawn_tiles_x[k], ctx.spawn_tiles_y[k])) return false;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// SAVE / LOAD
+// ----------------------------------------------------------------------------
+bool saveCheckpoint(const SimulationContext &ctx, const string &path) {
+    CheckpointWriter w;
+    putBytes(w, CHECKPOINT_MAGIC, 8);
+    uint32_t version = CHECKPOINT_VERSION;
+    putBytes(w, &version, 4);
+    // The writer only reads the context
+    checkpointFields(w, const_cast<SimulationContext &>(ctx));
+
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        LOG_ERROR("Error: Cannot write checkpoint " << path);
+        return false;
+    }
+    bool ok = fwrite(w.out.data(), 1, w.out.size(), f) == w.out.size();
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) LOG_ERROR("Error: Cannot write checkpoint " << path);
+    return ok;
+}
+
+bool loadCheckpoint(SimulationContext &ctx, const string &path) {
+    MappedFile file;
+    if (!mapFile(path, file)) {
+        LOG_ERROR("Error: Cannot open checkpoint " << path);
+        return false;
+    }
+
+    CheckpointReader r;
+    r.p = file.data;
+    r.end = file.data + file.size;
+    r.ok = true;
+
+    char magic[8] = {0};
+    uint32_t version = 0;
+    takeBytes(r, magic, 8);
+    takeBytes(r, &version, 4);
+    if (!r.ok || memcmp(magic, CHECKPOINT_MAGIC, 8) != 0 || version != CHECKPOINT_VERSION) {
+        unmapFile(file);
+        LOG_ERROR("Error: " << path << " is not a checkpoint of this version");
+        return false;
+    }
+
+    // Restore into a copy so a bad file leaves ctx untouched; output
+    // settings carry over from ctx.
+    SimulationContext restored(ctx);
+    checkpointFields(r, restored);
+    bool complete = r.ok && r.p == r.end;
+    unmapFile(file);
+
+    if (!complete || !checkpointConsistent(restored)) {
+        LOG_ERROR("Error: " << path << " is truncated or corrupt");
+        return false;
+    }
+
+    buildSwitchMap(restored);
+    compileTileKinds(restored);
+    rebuildOccupancyIndex(restored);
+    rebuildSpawnQueue(restored);
+    buildTrackDistances(restored);
+    resetStateHash(restored);
+
+    swap(ctx, restored);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// DEFAULT-CONTEXT WRAPPERS
+// ----------------------------------------------------------------------------
+bool saveCheckpoint(const string &path) { return saveCheckpoint(default_context, path); }
+bool loadCheckpoint(const string &path) { return loadCheckpoint(default_context, path); }
@@ -0,0 +1,34 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <string>
+#include "simulation_state.h"
+
+// ============================================================================
+// CHECKPOINT.H - Save and restore a running simulation
+// ============================================================================
+// A checkpoint holds the full simulation state of a context: the grid
+// (including safety-tile edits), every per-train and per-switch array
+// (counters and flip queue too), the spawn tiles, the current tick, the seed
+// and the RNG state. Restoring one needs no level file, and the restored
+// context continues exactly as the saved one would have.
+//
+// Output settings and open log streams are not part of a checkpoint; call
+// resumeLogFiles() after restoring to continue the interrupted run's logs.
+// Do not call initializeSimulation() after restoring, as it would reseed
+// the RNG.
+//
+// Layout (native little-endian): "SRCHKPT" magic, uint32 version, then
+// int32 counts and arrays in the order written by saveCheckpoint().
+// ============================================================================
+
+// Write the context's state to path. Returns true on success.
+bool saveCheckpoint(const SimulationContext &ctx, const std::string &path);
+bool saveCheckpoint(const std::string &path);
+
+// Replace the context's state with the checkpoint at path. On failure the
+// context is left unchanged and false is returned.
+bool loadCheckpoint(SimulationContext &ctx, const std::string &path);
+bool loadCheckpoint(const std::string &path);
+
+#endif
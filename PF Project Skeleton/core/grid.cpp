@@ -8,70 +8,74 @@
 // ----------------------------------------------------------------------------
 // Check if a position is inside the grid.
 // ----------------------------------------------------------------------------
-bool isInBounds(int x, int y) {
-    // Uses global grid_cols/rows from simulation_state.h
-    return (x >= 0 && x < grid_cols && y >= 0 && y < grid_rows);
+bool isInBounds(const SimulationContext &ctx, int x, int y) {
+    return isGridPosition(ctx.grid_rows, ctx.grid_cols, x, y);
+}
+
+bool isGridPosition(int rows, int cols, int x, int y) {
+    return (x >= 0 && x < cols && y >= 0 && y < rows);
+}
+
+bool isGridPositionOrNone(int rows, int cols, int x, int y) {
+    return (x == -1 && y == -1) || isGridPosition(rows, cols, x, y);
+}
+
+bool isSaneDestination(int x, int y) {
+    return x >= -MAX_DESTINATION_COORD && x <= MAX_DESTINATION_COORD &&
+           y >= -MAX_DESTINATION_COORD && y <= MAX_DESTINATION_COORD;
 }
 
 // ----------------------------------------------------------------------------
 // Check if a tile is a track tile.
 // ----------------------------------------------------------------------------
 // Returns true if the tile is any valid rail component
-bool isTrackTile(int x, int y) {
-    if (!isInBounds(x, y)) return false;
-    char t = grid[y][x];
+bool isTrackTile(const SimulationContext &ctx, int x, int y) {
+    if (!isInBounds(ctx, x, y)) return false;
+    char t = ctx.grid[y][x];
     // Includes standard rails, curves, crossings, spawn, dest, safety, and switches
     return (t == '-' || t == '|' || t == '/' || t == '\\' || 
             t == '+' || t == 'S' || t == 'D' || t == '=' || 
             (t >= 'A' && t <= 'Z'));
 }
 
-// ----------------------------------------------------------------------------
-// Check if a tile is a switch.
-// ----------------------------------------------------------------------------
-bool isSwitchTile(int x, int y) {
-    if (!isInBounds(x, y)) return false;
-    char t = grid[y][x];
-    return (t >= 'A' && t <= 'Z');
-}
-
-// ----------------------------------------------------------------------------
-// Get switch index from character.
-// ----------------------------------------------------------------------------
-int getSwitchIndex(int x, int y) {
-    if (!isSwitchTile(x, y)) return -1;
-    return grid[y][x] - 'A';
-}
-
 // ----------------------------------------------------------------------------
 // Check if a position is a spawn point.
 // ----------------------------------------------------------------------------
-bool isSpawnPoint(int x, int y) {
-    if (!isInBounds(x, y)) return false;
-    return grid[y][x] == 'S';
+bool isSpawnPoint(const SimulationContext &ctx, int x, int y) {
+    if (!isInBounds(ctx, x, y)) return false;
+    return ctx.grid[y][x] == 'S';
 }
 
 // ----------------------------------------------------------------------------
 // Check if a position is a destination.
 // ----------------------------------------------------------------------------
-bool isDestinationPoint(int x, int y) {
-    if (!isInBounds(x, y)) return false;
-    return grid[y][x] == 'D';
+bool isDestinationPoint(const SimulationContext &ctx, int x, int y) {
+    if (!isInBounds(ctx, x, y)) return false;
+    return ctx.grid[y][x] == 'D';
 }
 
 // ----------------------------------------------------------------------------
 // Toggle a safety tile.
 // ----------------------------------------------------------------------------
-bool toggleSafetyTile(int x, int y) {
-    if (!isInBounds(x, y)) return false;
+bool toggleSafetyTile(SimulationContext &ctx, int x, int y) {
+    if (!isInBounds(ctx, x, y)) return false;
     
     // Can only place safety on straight tracks or remove existing safety
-    if (grid[y][x] == '-') {
-        grid[y][x] = '=';
+    if (ctx.grid[y][x] == '-') {
+        ctx.grid[y][x] = '=';
         return true;
-    } else if (grid[y][x] == '=') {
-        grid[y][x] = '-';
+    } else if (ctx.grid[y][x] == '=') {
+        ctx.grid[y][x] = '-';
         return true;
     }
     return false;
-}
\ No newline at end of file
+}
+
+// ----------------------------------------------------------------------------
+// Default-context wrappers
+// ----------------------------------------------------------------------------
+bool isInBounds(int x, int y) { return isInBounds(default_context, x, y); }
+bool isTrackTile(int x, int y) { return isTrackTile(default_context, x, y); }
+bool isSpawnPoint(int x, int y) { return isSpawnPoint(default_context, x, y); }
+bool isDestinationPoint(int x, int y) { return isDestinationPoint(default_context, x, y); }
+bool toggleSafetyTile(int x, int y) { return toggleSafetyTile(default_context, x, y); }
@@ -1,33 +1,47 @@
 #ifndef GRID_H
 #define GRID_H
 
+#include "simulation_state.h"
+
 // ============================================================================
 // GRID.H - Grid manipulation functions
 // ============================================================================
-// Functions for working with the 2D grid map.
+// Functions for working with the 2D grid map. The overloads without a
+// context operate on default_context.
 // ============================================================================
 
 // Check if a position is within grid bounds
+bool isInBounds(const SimulationContext &ctx, int x, int y);
 bool isInBounds(int x, int y);
 
+// Checks for compiled levels and checkpoints, whose coordinates are read
+// before the context is built: a tile of a rows x cols grid, or that or
+// (-1, -1) for "none" (a train without a spawn tile, an unplaced switch).
+bool isGridPosition(int rows, int cols, int x, int y);
+bool isGridPositionOrNone(int rows, int cols, int x, int y);
+
+// Destinations may lie off the grid, but within this range so distance
+// sums cannot overflow
+const int MAX_DESTINATION_COORD = 1 << 20;
+bool isSaneDestination(int x, int y);
+
 // Check if a tile is a track (can trains move on it?)
+bool isTrackTile(const SimulationContext &ctx, int x, int y);
 bool isTrackTile(int x, int y);
 
-// Check if a tile is a switch (A-Z)
-bool isSwitchTile(int x, int y);
-
-// Get the switch index (0-25) from a switch character (A-Z)
-// Returns -1 if not a switch
-int getSwitchIndex(int x, int y);
+// Switch lookups (isSwitchTile, getSwitchIndex) are in switches.h
 
 // Check if a position is a spawn point ('S')
+bool isSpawnPoint(const SimulationContext &ctx, int x, int y);
 bool isSpawnPoint(int x, int y);
 
 // Check if a position is a destination point ('D')
+bool isDestinationPoint(const SimulationContext &ctx, int x, int y);
 bool isDestinationPoint(int x, int y);
 
 // Place or remove a safety tile at a position (for mouse editing)
 // Returns true if successful
+bool toggleSafetyTile(SimulationContext &ctx, int x, int y);
 bool toggleSafetyTile(int x, int y);
 
 #endif
\ No newline at end of file
@@ -1,226 +1,931 @@
-#include <iostream>
 #include <fstream>
 #include <string>
 #include <cstdlib>
 #include <cstring>
+#include <cstdio>
+#include <vector>
+#include <map>
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "simulation_state.h"
 #include "io.h"
 #include "trains.h"
+#include "switches.h"
+#include "grid.h"
+#include "log_sink.h"
+#include "state_hash.h"
+#include "track_distance.h"
+#include "profile.h"
+#include "log.h"
 
 using namespace std;
 
-int train_wait[MAX_TRAINS];
-int train_priority[MAX_TRAINS];
+// ----------------------------------------------------------------------------
+// FILE MAPPING
+// ----------------------------------------------------------------------------
+bool mapFile(const string &path, MappedFile &file) {
+    file.data = NULL;
+    file.size = 0;
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    file.size = (size_t)st.st_size;
+    if (file.size == 0) {
+        close(fd);
+        return true;
+    }
+    void *m = mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return false;
+    file.data = (const unsigned char *)m;
+    return true;
+#else
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    file.size = (len > 0) ? (size_t)len : 0;
+    unsigned char *buf = file.size ? (unsigned char *)malloc(file.size) : NULL;
+    size_t got = buf ? fread(buf, 1, file.size, f) : 0;
+    fclose(f);
+    if (got != file.size) {
+        free(buf);
+        return false;
+    }
+    file.data = buf;
+    return true;
+#endif
+}
+
+void unmapFile(MappedFile &file) {
+    if (file.data) {
+#ifndef _WIN32
+        munmap((void *)file.data, file.size);
+#else
+        free((void *)file.data);
+#endif
+    }
+    file.data = NULL;
+    file.size = 0;
+}
+
+// ----------------------------------------------------------------------------
+// LEVEL PARSER
+// ----------------------------------------------------------------------------
+// Lines are [begin, end) spans of the mapped file. The scanners below accept
+// what the atoi/sscanf calls of the original line-based loader accepted, so
+// existing level files load exactly as before.
+// ----------------------------------------------------------------------------
+enum LevelSection {
+    SECTION_NONE, SECTION_ROWS, SECTION_COLS, SECTION_SEED, SECTION_WEATHER,
+    SECTION_MAP, SECTION_SWITCHES, SECTION_TRAINS
+};
+
+static bool isSpaceChar(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static bool spanIs(const char *b, const char *e, const char *text) {
+    size_t n = strlen(text);
+    return (size_t)(e - b) == n && memcmp(b, text, n) == 0;
+}
+
+// sscanf "%d": skip whitespace, optional sign, at least one digit.
+static bool scanInt(const char *&p, const char *e, int &value) {
+    const char *q = p;
+    while (q < e && isSpaceChar(*q)) q++;
+    bool negative = false;
+    if (q < e && (*q == '+' || *q == '-')) negative = (*q++ == '-');
+    if (q >= e || *q < '0' || *q > '9') return false;
+    unsigned int v = 0;
+    while (q < e && *q >= '0' && *q <= '9') v = v * 10 + (unsigned int)(*q++ - '0');
+    value = negative ? (int)(0u - v) : (int)v;
+    p = q;
+    return true;
+}
+
+// atoi: like scanInt, but 0 when there is no number.
+static int spanAtoi(const char *b, const char *e) {
+    int v = 0;
+    return scanInt(b, e, v) ? v : 0;
+}
+
+// sscanf "%<maxLen>s": skip whitespace, take up to maxLen non-space chars.
+static bool scanToken(const char *&p, const char *e, int maxLen, const char *&token, int &len) {
+    while (p < e && isSpaceChar(*p)) p++;
+    token = p;
+    while (p < e && !isSpaceChar(*p) && p - token < maxLen) p++;
+    len = (int)(p - token);
+    return len > 0;
+}
+
+// False when ROWS/COLS no longer match the grid storage (no MAP section yet,
+// or ROWS/COLS given again after it).
+static bool gridMatchesSize(const SimulationContext &ctx) {
+    if ((int)ctx.grid.size() != ctx.grid_rows) return false;
+    return ctx.grid_rows == 0 || (int)ctx.grid[0].size() == ctx.grid_cols;
+}
 
-static string trim(const string &s) {
-    int a = 0, b = (int)s.size() - 1;
-    while (a <= b && isspace((unsigned char)s[a])) a++;
-    while (b >= a && isspace((unsigned char)s[b])) b--;
-    if (b < a) return "";
-    return s.substr(a, b - a + 1);
+static void levelWarning(const string &path, int lineNo, const char *lineStart, const char *at, const char *msg) {
+    LOG_WARN(path << ":" << lineNo << ":" << (at - lineStart + 1) << ": warning: " << msg);
 }
 
-bool loadLevelFile(string filepath) {
+bool loadLevelFile(SimulationContext &ctx, string filepath) {
 
-    cout << "DEBUG: Attempting to load: " << filepath << endl;
+    LOG_DEBUG("Attempting to load: " << filepath);
 
-    ifstream file(filepath);
-    if (!file.is_open()) {
-        cout << "Error: Cannot open level file " << filepath << "\n";
+    MappedFile file;
+    if (!mapFile(filepath, file)) {
+        LOG_ERROR("Error: Cannot open level file " << filepath);
         return false;
     }
 
-    cout << "DEBUG: File opened successfully!" << endl;
+    LOG_DEBUG("File opened successfully!");
 
-    total_trains = 0;
-    train_count = 0;
-    current_tick = 0;
+    ctx.total_trains = 0;
+    ctx.train_count = 0;
+    ctx.current_tick = 0;
     
-    grid_rows = 0;
-    grid_cols = 0;
+    resizeGrid(ctx, 0, 0);
+    resizeTrainArrays(ctx, 0);
+    resizeSwitchArrays(ctx, 0);
+    ctx.total_switches = 0;
 
-    for (int i = 0; i < MAX_SWITCHES; i++)
-        switch_active[i] = false;
-
-    string rawLine;
-    string section = "NONE";
+    LevelSection section = SECTION_NONE;
     int mapRow = 0;
-
-    while (getline(file, rawLine)) {
-
-        string line = trim(rawLine);
-        if (line.empty()) continue;
-
-        if (line == "ROWS:")       { section = "ROWS"; continue; }
-        if (line == "COLS:")       { section = "COLS"; continue; }
-        if (line == "SEED:")       { section = "SEED"; continue; }
-        if (line == "WEATHER:")    { section = "WEATHER"; continue; }
-        if (line == "MAP:")        { section = "MAP"; mapRow = 0; continue; }
-        if (line == "SWITCHES:")   { section = "SWITCHES"; continue; }
-        if (line == "TRAINS:")     { section = "TRAINS"; continue; }
-
-        if (section == "ROWS") {
-            grid_rows = atoi(line.c_str());
-            cout << "DEBUG: Read ROWS = " << grid_rows << endl;
-            if (grid_rows > MAX_ROWS) {
-                cout << "Warning: grid_rows=" << grid_rows << " exceeds MAX_ROWS=" << MAX_ROWS << ", clamping.\n";
-                grid_rows = MAX_ROWS;
-            }
+    map<string, int> switchIds;
+
+    // Last tile (row-major) holding each character, for placing single-letter
+    // switches. Built on first use after the MAP rows are in.
+    vector<int> lastTileOf;
+
+    const char *p = (const char *)file.data;
+    const char *fileEnd = p + file.size;
+    int lineNo = 0;
+
+    while (p < fileEnd) {
+        const char *rawBegin = p;
+        const char *newline = (const char *)memchr(p, '\n', fileEnd - p);
+        const char *rawEnd = newline ? newline : fileEnd;
+        p = newline ? newline + 1 : fileEnd;
+        lineNo++;
+
+        // Trimmed line
+        const char *b = rawBegin, *e = rawEnd;
+        while (b < e && isSpaceChar(*b)) b++;
+        while (e > b && isSpaceChar(e[-1])) e--;
+        if (b == e) continue;
+
+        if (spanIs(b, e, "ROWS:"))     { section = SECTION_ROWS; continue; }
+        if (spanIs(b, e, "COLS:"))     { section = SECTION_COLS; continue; }
+        if (spanIs(b, e, "SEED:"))     { section = SECTION_SEED; continue; }
+        if (spanIs(b, e, "WEATHER:"))  { section = SECTION_WEATHER; continue; }
+        if (spanIs(b, e, "MAP:")) {
+            section = SECTION_MAP;
+            mapRow = 0;
+            resizeGrid(ctx, ctx.grid_rows, ctx.grid_cols);
             continue;
         }
+        if (spanIs(b, e, "SWITCHES:")) { section = SECTION_SWITCHES; continue; }
+        if (spanIs(b, e, "TRAINS:"))   { section = SECTION_TRAINS; continue; }
 
-        if (section == "COLS") {
-            grid_cols = atoi(line.c_str());
-            cout << "DEBUG: Read COLS = " << grid_cols << endl;
-            if (grid_cols > MAX_COLS) {
-                cout << "Warning: grid_cols=" << grid_cols << " exceeds MAX_COLS=" << MAX_COLS << ", clamping.\n";
-                grid_cols = MAX_COLS;
-            }
+        if (section == SECTION_ROWS) {
+            ctx.grid_rows = spanAtoi(b, e);
+            LOG_DEBUG("Read ROWS = " << ctx.grid_rows);
             continue;
         }
 
-        if (section == "SEED") {
-            simulation_seed = atoi(line.c_str());
+        if (section == SECTION_COLS) {
+            ctx.grid_cols = spanAtoi(b, e);
+            LOG_DEBUG("Read COLS = " << ctx.grid_cols);
             continue;
         }
 
-        if (section == "WEATHER") continue;
-
-        if (section == "MAP") {
-            if (mapRow < grid_rows && mapRow < MAX_ROWS) {
-
-                string rowLine = rawLine;
-
-                if ((int)rowLine.size() < grid_cols) {
-                    rowLine.append(grid_cols - rowLine.size(), ' ');
-                }
-
-                int colLimit = grid_cols;
-                if (colLimit > MAX_COLS) colLimit = MAX_COLS;
+        if (section == SECTION_SEED) {
+            ctx.simulation_seed = spanAtoi(b, e);
+            continue;
+        }
 
-                for (int c = 0; c < colLimit; c++) {
-                    char ch = (c < (int)rowLine.size() ? rowLine[c] : ' ');
-                    if (ch == ' ') ch = '.';
-                    grid[mapRow][c] = ch;
+        if (section == SECTION_MAP) {
+            // The untrimmed row goes straight into the grid; short rows are
+            // padded and spaces become '.'
+            if (mapRow < ctx.grid_rows) {
+                char *row = &ctx.grid[mapRow][0];
+                int len = (int)(rawEnd - rawBegin);
+                for (int c = 0; c < ctx.grid_cols; c++) {
+                    char ch = (c < len) ? rawBegin[c] : ' ';
+                    row[c] = (ch == ' ') ? '.' : ch;
                 }
-
                 mapRow++;
+                lastTileOf.clear();
+            } else if (mapRow++ == ctx.grid_rows) {
+                levelWarning(filepath, lineNo, rawBegin, b, "more MAP rows than ROWS, ignoring the rest");
             }
             continue;
         }
 
-        if (section == "SWITCHES") {
-            char swChar;
-            char modeStr[32];
+        if (section == SECTION_SWITCHES) {
+            const char *q = b;
+            const char *nameTok, *modeTok;
+            int nameLen, modeLen;
             int state = 0;
-            int k1 = 0, k2 = 0, k3 = 0, k4 = 0;
-
-            if (sscanf(line.c_str(), "%c %s %d %d %d %d %d", 
-                       &swChar, modeStr, &state, &k1, &k2, &k3, &k4) < 3) continue;
+            int k[4] = {0, 0, 0, 0};
 
-            int idx = swChar - 'A';
-            if (idx < 0 || idx >= MAX_SWITCHES) continue;
-
-            switch_active[idx] = true;
-            switch_state[idx] = state;
-            switch_k_values[idx][0] = k1;
-            switch_k_values[idx][1] = k2;
-            switch_k_values[idx][2] = k3;
-            switch_k_values[idx][3] = k4;
-
-            for (int d = 0; d < 4; d++)
-                switch_counters[idx][d] = switch_k_values[idx][d];
+            scanToken(q, e, 63, nameTok, nameLen);
+            if (!scanToken(q, e, 31, modeTok, modeLen)) {
+                levelWarning(filepath, lineNo, rawBegin, q, "expected switch mode, line skipped");
+                continue;
+            }
+            while (q < e && isSpaceChar(*q)) q++;
+            const char *stateTok = q;
+            if (!scanInt(q, e, state)) {
+                levelWarning(filepath, lineNo, rawBegin, q, "expected switch state, line skipped");
+                continue;
+            }
+            // Routing treats anything but 1 as straight
+            if (state != 0 && state != 1) {
+                levelWarning(filepath, lineNo, rawBegin, stateTok, "switch state must be 0 or 1, using 0");
+                state = 0;
+            }
+            for (int d = 0; d < 4 && scanInt(q, e, k[d]); d++) {}
+
+            string name(nameTok, nameLen);
+            int idx;
+            map<string, int>::iterator known = switchIds.find(name);
+            if (known != switchIds.end()) {
+                idx = known->second;
+            } else {
+                idx = ctx.total_switches++;
+                resizeSwitchArrays(ctx, ctx.total_switches);
+                ctx.switch_name[idx] = name;
+                switchIds[name] = idx;
+            }
 
-            for (int r = 0; r < grid_rows && r < MAX_ROWS; r++)
-                for (int c = 0; c < grid_cols && c < MAX_COLS; c++)
-                    if (grid[r][c] == swChar) {
-                        switch_x[idx] = c;
-                        switch_y[idx] = r;
-                    }
+            ctx.switch_active[idx] = true;
+            ctx.switch_state[idx] = state;
+            for (int d = 0; d < 4; d++) {
+                ctx.switch_k_values[idx][d] = k[d];
+                ctx.switch_counters[idx][d] = k[d];
+            }
 
+            // Position: explicit "@x,y" token, else the map tile with the
+            // switch's letter (single-letter names only)
+            const char *at = (const char *)memchr(b, '@', e - b);
+            const char *xy = at ? at + 1 : NULL;
+            int px, py;
+            if (at && scanInt(xy, e, px) && xy < e && *xy == ',' && scanInt(++xy, e, py)) {
+                if (isInBounds(ctx, px, py)) {
+                    ctx.switch_x[idx] = px;
+                    ctx.switch_y[idx] = py;
+                } else {
+                    levelWarning(filepath, lineNo, rawBegin, at, "switch position is off the map, ignored");
+                }
+                continue;
+            }
+            if (at) levelWarning(filepath, lineNo, rawBegin, at, "expected @x,y");
+
+            // A redefinition without a position keeps the earlier one
+            if (nameLen != 1) {
+                if (!at && ctx.switch_x[idx] == -1)
+                    levelWarning(filepath, lineNo, rawBegin, nameTok,
+                                 "switch ID longer than one letter needs @x,y, switch left unplaced");
+                continue;
+            }
+            if (lastTileOf.empty() && gridMatchesSize(ctx)) {
+                lastTileOf.assign(256, -1);
+                for (int r = 0; r < ctx.grid_rows; r++)
+                    for (int c = 0; c < ctx.grid_cols; c++)
+                        lastTileOf[(unsigned char)ctx.grid[r][c]] = tileIndex(ctx, c, r);
+            }
+            int t = lastTileOf.empty() ? -1 : lastTileOf[(unsigned char)name[0]];
+            if (t != -1) {
+                ctx.switch_x[idx] = t % ctx.grid_cols;
+                ctx.switch_y[idx] = t / ctx.grid_cols;
+            } else if (ctx.switch_x[idx] == -1) {
+                levelWarning(filepath, lineNo, rawBegin, nameTok, "switch letter is not on the map, switch left unplaced");
+            }
             continue;
         }
 
-        if (section == "TRAINS") {
-            if (total_trains >= MAX_TRAINS) continue;
-
+        if (section == SECTION_TRAINS) {
             int spawn_tick, dest_x, dest_y, wait_time, priority;
+            const char *q = b;
 
-            if (sscanf(line.c_str(), "%d %d %d %d %d", 
-                       &spawn_tick, &dest_x, &dest_y, &wait_time, &priority) != 5) continue;
+            if (!scanInt(q, e, spawn_tick) || !scanInt(q, e, dest_x) || !scanInt(q, e, dest_y) ||
+                !scanInt(q, e, wait_time) || !scanInt(q, e, priority)) {
+                levelWarning(filepath, lineNo, rawBegin, q,
+                             "expected \"spawn_tick dest_x dest_y wait priority\", line skipped");
+                continue;
+            }
 
-            int i = total_trains;
+            int i = ctx.total_trains;
+            resizeTrainArrays(ctx, i + 1);
 
-            train_spawn_tick[i] = spawn_tick;
-            train_dest_x[i] = dest_x;
-            train_dest_y[i] = dest_y;
-            train_wait[i] = wait_time;
-            train_priority[i] = priority;
+            ctx.train_spawn_tick[i] = spawn_tick;
+            ctx.train_dest_x[i] = dest_x;
+            ctx.train_dest_y[i] = dest_y;
+            ctx.train_wait[i] = wait_time;
+            ctx.train_priority[i] = priority;
 
-            train_id[i] = i;
-            train_active[i] = false;
-            train_finished[i] = false;
-            train_arrival_tick[i] = -1;
+            ctx.train_id[i] = i;
+            ctx.train_active[i] = false;
+            ctx.train_finished[i] = false;
+            ctx.train_arrival_tick[i] = -1;
             
             // Position will be set when train spawns
-            train_x[i] = -1;
-            train_y[i] = -1;
-            train_direction[i] = 0;
+            ctx.train_x[i] = -1;
+            ctx.train_y[i] = -1;
+            ctx.train_direction[i] = 0;
 
-            total_trains++;
+            ctx.total_trains++;
             continue;
         }
     }
 
-    file.close();
+    unmapFile(file);
+    if (!gridMatchesSize(ctx)) resizeGrid(ctx, ctx.grid_rows, ctx.grid_cols);
+    buildSwitchMap(ctx);
+    compileTileKinds(ctx);
+    rebuildOccupancyIndex(ctx);
+    buildSpawnIndex(ctx);
+    buildTrackDistances(ctx);
+    resetStateHash(ctx);
     return true;
 }
 
-void initializeLogFiles() {
-    ofstream trace("out/trace.csv");
-    trace << "Tick,TrainID,X,Y,Direction,State\n";
-    trace.close();
+// Binary trace layout constants
+static const int TRACE_BLOCK_ROWS = 65536;
+static const int TRACE_VERSION = 1;
+static const int TRACE_COLUMNS = 6;
+static const char TRACE_MAGIC[8] = {'S', 'R', 'T', 'R', 'A', 'C', 'E', 0};
+static const char TRACE_INDEX_MAGIC[8] = {'S', 'R', 'T', 'R', 'I', 'D', 'X', 0};
+static const int TRACE_HEADER_SIZE = 24;
+static const int TRACE_INDEX_ENTRY_SIZE = 16;
+static const int TRACE_TRAILER_SIZE = 24;
+
+// Append an integer in decimal at p; returns the new end.
+static char *appendInt(char *p, int v) {
+    char tmp[12];
+    int n = 0;
+    unsigned int u = (v < 0) ? (unsigned int)(-(long long)v) : (unsigned int)v;
+    if (v < 0) *p++ = '-';
+    do {
+        tmp[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    while (n > 0) *p++ = tmp[--n];
+    return p;
+}
+
+static size_t padTo8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static void putU32(unsigned char *p, uint32_t v) { memcpy(p, &v, 4); }
+static void putU64(unsigned char *p, uint64_t v) { memcpy(p, &v, 8); }
+static uint32_t getU32(const unsigned char *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static uint64_t getU64(const unsigned char *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+
+// Bytes taken by one block of n rows.
+static size_t traceBlockBytes(size_t n) {
+    return padTo8(n * 4 * 4 + n * 2);
+}
+
+static void traceBinWrite(SimulationContext &ctx, const void *data, size_t len) {
+    logStreamWrite(ctx.trace_stream, (const char *)data, (int)len);
+    ctx.bin_offset += len;
+}
+
+// Serialize the rows collected so far as one block and record it in the index.
+static void flushTraceBlock(SimulationContext &ctx) {
+    size_t n = ctx.bin_tick.size();
+    if (n == 0) return;
+
+    unsigned char entry[TRACE_INDEX_ENTRY_SIZE];
+    putU64(entry, ctx.bin_offset);
+    putU32(entry + 8, (uint32_t)n);
+    putU32(entry + 12, (uint32_t)ctx.bin_tick[0]);
+    ctx.bin_index.insert(ctx.bin_index.end(), entry, entry + TRACE_INDEX_ENTRY_SIZE);
+
+    traceBinWrite(ctx, ctx.bin_tick.data(), n * 4);
+    traceBinWrite(ctx, ctx.bin_train.data(), n * 4);
+    traceBinWrite(ctx, ctx.bin_x.data(), n * 4);
+    traceBinWrite(ctx, ctx.bin_y.data(), n * 4);
+    traceBinWrite(ctx, ctx.bin_dir.data(), n);
+    traceBinWrite(ctx, ctx.bin_state.data(), n);
+
+    static const unsigned char zeros[8] = {0};
+    size_t pad = traceBlockBytes(n) - (n * 4 * 4 + n * 2);
+    if (pad > 0) traceBinWrite(ctx, zeros, pad);
+
+    ctx.bin_tick.clear(); ctx.bin_train.clear(); ctx.bin_x.clear(); ctx.bin_y.clear();
+    ctx.bin_dir.clear(); ctx.bin_state.clear();
+}
+
+// Write the last block, the block index and the trailer.
+static void finishBinaryTrace(SimulationContext &ctx) {
+    flushTraceBlock(ctx);
 
-    ofstream sw("out/switches.csv");
-    sw << "Tick,Switch,State\n";
-    sw.close();
+    uint64_t indexOffset = ctx.bin_offset;
+    if (!ctx.bin_index.empty()) traceBinWrite(ctx, ctx.bin_index.data(), ctx.bin_index.size());
 
-    ofstream m("out/metrics.txt");
+    unsigned char trailer[TRACE_TRAILER_SIZE];
+    putU64(trailer, indexOffset);
+    putU32(trailer + 8, (uint32_t)(ctx.bin_index.size() / TRACE_INDEX_ENTRY_SIZE));
+    putU32(trailer + 12, 0);
+    memcpy(trailer + 16, TRACE_INDEX_MAGIC, 8);
+    traceBinWrite(ctx, trailer, TRACE_TRAILER_SIZE);
+
+    ctx.bin_index.clear();
+}
+
+void setTraceFormat(SimulationContext &ctx, int format) {
+    ctx.trace_format = (format == TRACE_FORMAT_BINARY) ? TRACE_FORMAT_BINARY : TRACE_FORMAT_CSV;
+}
+
+static const char TRACE_CSV_HEADER[] = "Tick,TrainID,X,Y,Direction,State\n";
+static const char SWITCH_CSV_HEADER[] = "Tick,Switch,State\n";
+static const char HASH_CSV_HEADER[] = "Tick,Hash,Trains,Switches\n";
+
+static void clearBinaryTrace(SimulationContext &ctx) {
+    ctx.bin_offset = 0;
+    ctx.bin_index.clear();
+    ctx.bin_tick.clear(); ctx.bin_train.clear(); ctx.bin_x.clear(); ctx.bin_y.clear();
+    ctx.bin_dir.clear(); ctx.bin_state.clear();
+}
+
+static void writeTraceHeader(SimulationContext &ctx) {
+    unsigned char header[TRACE_HEADER_SIZE];
+    memcpy(header, TRACE_MAGIC, 8);
+    putU32(header + 8, TRACE_VERSION);
+    putU32(header + 12, TRACE_COLUMNS);
+    putU32(header + 16, TRACE_BLOCK_ROWS);
+    putU32(header + 20, 0);
+    traceBinWrite(ctx, header, TRACE_HEADER_SIZE);
+}
+
+void initializeLogFiles(SimulationContext &ctx) {
+    closeLogFiles(ctx);
+
+    if (ctx.trace_format == TRACE_FORMAT_BINARY) {
+        ctx.trace_stream = openLogStream(ctx.output_dir + "/trace.bin");
+        clearBinaryTrace(ctx);
+        writeTraceHeader(ctx);
+    } else {
+        ctx.trace_stream = openLogStream(ctx.output_dir + "/trace.csv");
+        logStreamWrite(ctx.trace_stream, TRACE_CSV_HEADER, (int)strlen(TRACE_CSV_HEADER));
+    }
+
+    ctx.switch_stream = openLogStream(ctx.output_dir + "/switches.csv");
+    logStreamWrite(ctx.switch_stream, SWITCH_CSV_HEADER, (int)strlen(SWITCH_CSV_HEADER));
+
+    ctx.hash_stream = openLogStream(ctx.output_dir + "/hashes.csv");
+    logStreamWrite(ctx.hash_stream, HASH_CSV_HEADER, (int)strlen(HASH_CSV_HEADER));
+
+    ofstream m((ctx.output_dir + "/metrics.txt").c_str());
     m.close();
 }
 
-void logTrainTrace() {
-    ofstream file("out/trace.csv", ios::app);
-    for (int i = 0; i < total_trains; i++) {
-        if (train_active[i]) {
-            file << current_tick << "," << i << ","
-                 << train_x[i] << "," << train_y[i] << ","
-                 << train_direction[i] << ",0\n";
+// Cut a file down to its first `size` bytes.
+static bool truncateFile(const string &path, size_t size) {
+#ifndef _WIN32
+    return truncate(path.c_str(), (off_t)size) == 0;
+#else
+    MappedFile file;
+    if (!mapFile(path, file)) return false;
+    vector<unsigned char> keep(file.data, file.data + min(size, file.size));
+    unmapFile(file);
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(keep.data(), 1, keep.size(), f) == keep.size();
+    return (fclose(f) == 0) && ok;
+#endif
+}
+
+// Reopen a CSV log at its end for a resumed run. Rows after `tick` (from a
+// later stop of the same run) and a torn last line are dropped; a missing
+// or empty file gets its header.
+static int resumeCsvLog(const string &path, const char *header, int tick) {
+    MappedFile file;
+    size_t keep = 0;
+    bool exists = mapFile(path, file);
+    if (exists && file.size > 0) {
+        const char *begin = (const char *)file.data;
+        const char *end = begin + file.size;
+        const char *line = (const char *)memchr(begin, '\n', end - begin);
+        if (line) {
+            keep = line + 1 - begin;
+            while (keep < file.size) {
+                const char *b = begin + keep;
+                const char *e = (const char *)memchr(b, '\n', end - b);
+                if (!e || spanAtoi(b, e) > tick) break;
+                keep = e + 1 - begin;
+            }
         }
     }
-    file.close();
+    size_t size = file.size;
+    unmapFile(file);
+    if (exists && keep < size && !truncateFile(path, keep)) {
+        LOG_ERROR("Error: Cannot trim " << path << " for the resumed run");
+        return -1;
+    }
+
+    int stream = appendLogStream(path);
+    if (keep == 0) logStreamWrite(stream, header, (int)strlen(header));
+    return stream;
 }
 
-void logSwitchState() {
-    ofstream file("out/switches.csv", ios::app);
-    for (int s = 0; s < MAX_SWITCHES; s++) {
-        if (switch_active[s]) {
-            file << current_tick << "," << (char)('A' + s)
-                 << "," << switch_state[s] << "\n";
+// Reopen trace.bin for a resumed run: whole blocks up to `tick` stay in the
+// file, the rows up to `tick` of the next block go back into the pending
+// block, and everything after (including the old index and trailer) is cut
+// off. Returns false if there is no valid trace to continue.
+static bool resumeBinaryTrace(SimulationContext &ctx, const string &path, int tick) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    fclose(f);
+
+    BinaryTrace trace;
+    if (!openBinaryTrace(path, trace)) {
+        LOG_WARN("Starting a new " << path);
+        return false;
+    }
+
+    size_t end = trace.index - trace.base;
+    for (int b = 0; b < trace.block_count; b++) {
+        const unsigned char *entry = trace.index + (size_t)b * TRACE_INDEX_ENTRY_SIZE;
+        TraceBlockView v = binaryTraceBlock(trace, b);
+        if (v.rows == 0 || v.tick[v.rows - 1] <= tick) {
+            ctx.bin_index.insert(ctx.bin_index.end(), entry, entry + TRACE_INDEX_ENTRY_SIZE);
+            continue;
+        }
+        end = (size_t)getU64(entry);
+        for (int r = 0; r < v.rows && v.tick[r] <= tick; r++) {
+            ctx.bin_tick.push_back(v.tick[r]);
+            ctx.bin_train.push_back(v.train_id[r]);
+            ctx.bin_x.push_back(v.x[r]);
+            ctx.bin_y.push_back(v.y[r]);
+            ctx.bin_dir.push_back(v.direction[r]);
+            ctx.bin_state.push_back(v.state[r]);
         }
+        break;
     }
-    file.close();
+    closeBinaryTrace(trace);
+
+    if (!truncateFile(path, end)) {
+        LOG_ERROR("Error: Cannot trim " << path << " for the resumed run");
+        return false;
+    }
+    ctx.bin_offset = end;
+    ctx.trace_stream = appendLogStream(path);
+    return ctx.trace_stream >= 0;
+}
+
+void resumeLogFiles(SimulationContext &ctx) {
+    closeLogFiles(ctx);
+    int tick = ctx.current_tick;
+
+    if (ctx.trace_format == TRACE_FORMAT_BINARY) {
+        clearBinaryTrace(ctx);
+        if (!resumeBinaryTrace(ctx, ctx.output_dir + "/trace.bin", tick)) {
+            clearBinaryTrace(ctx);
+            ctx.trace_stream = openLogStream(ctx.output_dir + "/trace.bin");
+            writeTraceHeader(ctx);
+        }
+    } else {
+        ctx.trace_stream = resumeCsvLog(ctx.output_dir + "/trace.csv", TRACE_CSV_HEADER, tick);
+    }
+    ctx.switch_stream = resumeCsvLog(ctx.output_dir + "/switches.csv", SWITCH_CSV_HEADER, tick);
+    ctx.hash_stream = resumeCsvLog(ctx.output_dir + "/hashes.csv", HASH_CSV_HEADER, tick);
+}
+
+void logTrainTrace(SimulationContext &ctx) {
+    if (ctx.trace_stream < 0) return;
+
+    if (ctx.trace_format == TRACE_FORMAT_BINARY) {
+        for (int i = 0; i < ctx.total_trains; i++) {
+            if (!ctx.train_active[i]) continue;
+            ctx.bin_tick.push_back(ctx.current_tick);
+            ctx.bin_train.push_back(i);
+            ctx.bin_x.push_back(ctx.train_x[i]);
+            ctx.bin_y.push_back(ctx.train_y[i]);
+            ctx.bin_dir.push_back((uint8_t)ctx.train_direction[i]);
+            ctx.bin_state.push_back(0);
+            if ((int)ctx.bin_tick.size() >= TRACE_BLOCK_ROWS) flushTraceBlock(ctx);
+        }
+        return;
+    }
+
+    char row[80];
+    for (int i = 0; i < ctx.total_trains; i++) {
+        if (ctx.train_active[i]) {
+            char *p = row;
+            p = appendInt(p, ctx.current_tick); *p++ = ',';
+            p = appendInt(p, i);            *p++ = ',';
+            p = appendInt(p, ctx.train_x[i]);   *p++ = ',';
+            p = appendInt(p, ctx.train_y[i]);   *p++ = ',';
+            p = appendInt(p, ctx.train_direction[i]);
+            *p++ = ','; *p++ = '0'; *p++ = '\n';
+            logStreamWrite(ctx.trace_stream, row, (int)(p - row));
+        }
+    }
+}
+
+void logSwitchState(SimulationContext &ctx) {
+    if (ctx.switch_stream < 0) return;
+
+    char row[96];
+    for (int s = 0; s < ctx.total_switches; s++) {
+        if (ctx.switch_active[s]) {
+            const string &name = ctx.switch_name[s];  // at most 63 chars (loader)
+            char *p = row;
+            p = appendInt(p, ctx.current_tick); *p++ = ',';
+            memcpy(p, name.data(), name.size());
+            p += name.size();               *p++ = ',';
+            p = appendInt(p, ctx.switch_state[s]);
+            *p++ = '\n';
+            logStreamWrite(ctx.switch_stream, row, (int)(p - row));
+        }
+    }
+}
+
+// Append a 64-bit value as 16 hex digits at p; returns the new end.
+static char *appendHex64(char *p, unsigned long long v) {
+    static const char digits[] = "0123456789abcdef";
+    for (int shift = 60; shift >= 0; shift -= 4) *p++ = digits[(v >> shift) & 15];
+    return p;
+}
+
+static void writeHashRow(SimulationContext &ctx, int tick) {
+    char row[80];
+    char *p = row;
+    p = appendInt(p, tick);                               *p++ = ',';
+    p = appendHex64(p, tickStateHash(ctx, tick));         *p++ = ',';
+    p = appendHex64(p, ctx.trains_hash);                  *p++ = ',';
+    p = appendHex64(p, ctx.switches_hash);                *p++ = '\n';
+    logStreamWrite(ctx.hash_stream, row, (int)(p - row));
+}
+
+void logStateHash(SimulationContext &ctx) {
+    if (ctx.hash_stream < 0) return;
+    writeHashRow(ctx, ctx.current_tick);
 }
 
-void writeMetrics() {
-    ofstream file("out/metrics.txt");
+void logIdleTicks(SimulationContext &ctx, int firstTick, int lastTick) {
+    if (ctx.hash_stream >= 0) {
+        for (int tick = firstTick; tick <= lastTick; tick++) writeHashRow(ctx, tick);
+    }
+    if (ctx.switch_stream < 0) return;
+
+    // ",name,state\n" for every active switch, formatted once
+    string rows;
+    vector<int> rowEnd;
+    char num[16];
+    for (int s = 0; s < ctx.total_switches; s++) {
+        if (!ctx.switch_active[s]) continue;
+        rows += ',';
+        rows += ctx.switch_name[s];
+        rows += ',';
+        rows.append(num, appendInt(num, ctx.switch_state[s]) - num);
+        rows += '\n';
+        rowEnd.push_back((int)rows.size());
+    }
+    if (rowEnd.empty()) return;
+
+    vector<char> block;
+    for (int tick = firstTick; tick <= lastTick; tick++) {
+        char prefix[16];
+        int prefixLen = (int)(appendInt(prefix, tick) - prefix);
+        block.clear();
+        int start = 0;
+        for (size_t r = 0; r < rowEnd.size(); r++) {
+            block.insert(block.end(), prefix, prefix + prefixLen);
+            block.insert(block.end(), rows.begin() + start, rows.begin() + rowEnd[r]);
+            start = rowEnd[r];
+        }
+        logStreamWrite(ctx.switch_stream, block.data(), (int)block.size());
+    }
+}
+
+void closeLogFiles(SimulationContext &ctx) {
+    if (ctx.trace_stream >= 0 && ctx.trace_format == TRACE_FORMAT_BINARY) {
+        finishBinaryTrace(ctx);
+    }
+    closeLogStream(ctx.trace_stream);
+    closeLogStream(ctx.switch_stream);
+    closeLogStream(ctx.hash_stream);
+    ctx.trace_stream = -1;
+    ctx.switch_stream = -1;
+    ctx.hash_stream = -1;
+}
+
+void writeMetrics(SimulationContext &ctx) {
+    ofstream file((ctx.output_dir + "/metrics.txt").c_str());
     int delivered = 0;
 
-    for (int i = 0; i < total_trains; i++)
-        if (train_finished[i]) delivered++;
+    for (int i = 0; i < ctx.total_trains; i++)
+        if (ctx.train_finished[i]) delivered++;
 
     file << "Simulation Report\n";
-    file << "Total trains: " << total_trains << "\n";
+    file << "Total trains: " << ctx.total_trains << "\n";
     file << "Delivered: " << delivered << "\n";
     file.close();
-}
\ No newline at end of file
+
+    writeProfile(ctx);
+}
+
+// ----------------------------------------------------------------------------
+// DEFAULT-CONTEXT WRAPPERS
+// ----------------------------------------------------------------------------
+bool loadLevelFile(string filepath) { return loadLevelFile(default_context, filepath); }
+void setTraceFormat(int format) { setTraceFormat(default_context, format); }
+void initializeLogFiles() { initializeLogFiles(default_context); }
+void resumeLogFiles() { resumeLogFiles(default_context); }
+void logTrainTrace() { logTrainTrace(default_context); }
+void logSwitchState() { logSwitchState(default_context); }
+void closeLogFiles() { closeLogFiles(default_context); }
+void writeMetrics() { writeMetrics(default_context); }
+
+// ----------------------------------------------------------------------------
+// BINARY TRACE READER
+// ----------------------------------------------------------------------------
+static void releaseMapping(const unsigned char *base, size_t size) {
+    if (!base) return;
+#ifndef _WIN32
+    munmap((void *)base, size);
+#else
+    (void)size;
+    free((void *)base);
+#endif
+}
+
+bool openBinaryTrace(const string &path, BinaryTrace &trace) {
+    trace.base = NULL;
+    trace.size = 0;
+    trace.block_count = 0;
+    trace.total_rows = 0;
+    trace.index = NULL;
+
+    const unsigned char *base = NULL;
+    size_t size = 0;
+
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Error: Cannot open trace file " << path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < TRACE_HEADER_SIZE + TRACE_TRAILER_SIZE) {
+        close(fd);
+        LOG_ERROR("Error: " << path << " is too small to be a binary trace");
+        return false;
+    }
+    size = (size_t)st.st_size;
+    void *m = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        LOG_ERROR("Error: Cannot map trace file " << path);
+        return false;
+    }
+    base = (const unsigned char *)m;
+#else
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) {
+        LOG_ERROR("Error: Cannot open trace file " << path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (len < TRACE_HEADER_SIZE + TRACE_TRAILER_SIZE) {
+        fclose(f);
+        LOG_ERROR("Error: " << path << " is too small to be a binary trace");
+        return false;
+    }
+    size = (size_t)len;
+    unsigned char *buf = (unsigned char *)malloc(size);
+    size_t got = buf ? fread(buf, 1, size, f) : 0;
+    fclose(f);
+    if (got != size) {
+        free(buf);
+        LOG_ERROR("Error: Cannot read trace file " << path);
+        return false;
+    }
+    base = buf;
+#endif
+
+    const unsigned char *trailer = base + size - TRACE_TRAILER_SIZE;
+    uint64_t indexOffset = getU64(trailer);
+    uint32_t blocks = getU32(trailer + 8);
+
+    bool ok = memcmp(base, TRACE_MAGIC, 8) == 0 &&
+              getU32(base + 8) == (uint32_t)TRACE_VERSION &&
+              getU32(base + 12) == (uint32_t)TRACE_COLUMNS &&
+              memcmp(trailer + 16, TRACE_INDEX_MAGIC, 8) == 0 &&
+              indexOffset >= (uint64_t)TRACE_HEADER_SIZE &&
+              indexOffset + (uint64_t)blocks * TRACE_INDEX_ENTRY_SIZE == size - TRACE_TRAILER_SIZE;
+
+    long long rows = 0;
+    for (uint32_t b = 0; ok && b < blocks; b++) {
+        const unsigned char *entry = base + indexOffset + (size_t)b * TRACE_INDEX_ENTRY_SIZE;
+        uint64_t off = getU64(entry);
+        uint32_t n = getU32(entry + 8);
+        if (off % 8 != 0 || off < (uint64_t)TRACE_HEADER_SIZE ||
+            off + traceBlockBytes(n) > indexOffset) {
+            ok = false;
+        }
+        rows += n;
+    }
+
+    if (!ok) {
+        releaseMapping(base, size);
+        LOG_ERROR("Error: " << path << " is not a valid binary trace");
+        return false;
+    }
+
+    trace.base = base;
+    trace.size = size;
+    trace.block_count = (int)blocks;
+    trace.total_rows = rows;
+    trace.index = base + indexOffset;
+    return true;
+}
+
+TraceBlockView binaryTraceBlock(const BinaryTrace &trace, int block) {
+    TraceBlockView v;
+    const unsigned char *entry = trace.index + (size_t)block * TRACE_INDEX_ENTRY_SIZE;
+    const unsigned char *p = trace.base + getU64(entry);
+    size_t n = getU32(entry + 8);
+
+    v.rows = (int)n;
+    v.tick = (const int32_t *)p;
+    v.train_id = (const int32_t *)(p + n * 4);
+    v.x = (const int32_t *)(p + n * 8);
+    v.y = (const int32_t *)(p + n * 12);
+    v.direction = p + n * 16;
+    v.state = p + n * 17;
+    return v;
+}
+
+void closeBinaryTrace(BinaryTrace &trace) {
+    releaseMapping(trace.base, trace.size);
+    trace.base = NULL;
+    trace.size = 0;
+    trace.block_count = 0;
+    trace.total_rows = 0;
+    trace.index = NULL;
+}
+
+bool convertBinaryTraceToCsv(const string &binPath, const string &csvPath) {
+    BinaryTrace trace;
+    if (!openBinaryTrace(binPath, trace)) return false;
+
+    FILE *out = fopen(csvPath.c_str(), "wb");
+    if (!out) {
+        closeBinaryTrace(trace);
+        LOG_ERROR("Error: Cannot write " << csvPath);
+        return false;
+    }
+
+    fputs("Tick,TrainID,X,Y,Direction,State\n", out);
+
+    vector<char> buf(1 << 20);
+    char row[80];
+    size_t used = 0;
+    for (int b = 0; b < trace.block_count; b++) {
+        TraceBlockView v = binaryTraceBlock(trace, b);
+        for (int r = 0; r < v.rows; r++) {
+            char *p = row;
+            p = appendInt(p, v.tick[r]);      *p++ = ',';
+            p = appendInt(p, v.train_id[r]);  *p++ = ',';
+            p = appendInt(p, v.x[r]);         *p++ = ',';
+            p = appendInt(p, v.y[r]);         *p++ = ',';
+            p = appendInt(p, v.direction[r]); *p++ = ',';
+            p = appendInt(p, v.state[r]);     *p++ = '\n';
+
+            size_t len = (size_t)(p - row);
+            if (used + len > buf.size()) {
+                fwrite(buf.data(), 1, used, out);
+                used = 0;
+            }
+            memcpy(buf.data() + used, row, len);
+            used += len;
+        }
+    }
+    if (used > 0) fwrite(buf.data(), 1, used, out);
+
+    fclose(out);
+    closeBinaryTrace(trace);
+    return true;
+}
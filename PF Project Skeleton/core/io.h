@@ -2,23 +2,121 @@
 #define IO_H
 
 #include <string>
+#include <cstddef>
+#include <stdint.h>
+#include "simulation_state.h"
 
-extern int train_wait[MAX_TRAINS];
-extern int train_priority[MAX_TRAINS];
-// Loads a .lvl level file and populates global arrays.
-// Returns true on success.
+// Functions taking a SimulationContext work on that context; the overloads
+// without one use default_context.
+
+// Loads a .lvl level file and populates global arrays, sized to the level.
+// SWITCHES lines are "<id> <mode> <state> <k_up> <k_right> <k_down> <k_left> ..."
+// with an optional "@x,y" token giving the switch tile; without it a
+// single-letter id binds to the tile carrying that letter.
+// The file is parsed in one pass over a memory mapping; MAP rows are copied
+// straight into the grid. Malformed SWITCHES/TRAINS lines are reported as
+// "file:line:col: warning: ..." and skipped.
+// Returns true on success (false only if the file cannot be read).
+bool loadLevelFile(SimulationContext &ctx, std::string filepath);
 bool loadLevelFile(std::string filepath);
 
-// Initializes all CSV/TXT log files (trace.csv, switches.csv, metrics.txt)
+// A whole file mapped read-only (mmap where available, else a heap copy).
+struct MappedFile {
+    const unsigned char *data;
+    size_t size;
+};
+
+// Map a file; an empty file maps to data == NULL, size 0. False if the file
+// cannot be opened or mapped.
+bool mapFile(const std::string &path, MappedFile &file);
+void unmapFile(MappedFile &file);
+
+// Trace output formats selectable before initializeLogFiles()
+const int TRACE_FORMAT_CSV = 0;     // out/trace.csv (default)
+const int TRACE_FORMAT_BINARY = 1;  // out/trace.bin, columnar (see below)
+
+// Select the trace format used by the next initializeLogFiles().
+void setTraceFormat(SimulationContext &ctx, int format);
+void setTraceFormat(int format);
+
+// Initializes all CSV/TXT log files (trace.csv or trace.bin, switches.csv,
+// hashes.csv, metrics.txt) in the context's output_dir ("out" by default)
+void initializeLogFiles(SimulationContext &ctx);
 void initializeLogFiles();
 
-// Logs train movement to trace.csv (APPEND MODE)
+// For a run restored from a checkpoint: reopen the same logs at their end so
+// the resumed ticks follow the interrupted run's rows. Rows after
+// ctx.current_tick (left by a later stop of the run) are dropped first; a
+// log that does not exist yet is started as initializeLogFiles() would.
+void resumeLogFiles(SimulationContext &ctx);
+void resumeLogFiles();
+
+// Logs train movement to the trace (buffered, written by a background thread)
+void logTrainTrace(SimulationContext &ctx);
 void logTrainTrace();
 
-// Logs switch state changes to switches.csv (APPEND MODE)
+// Logs switch state changes to switches.csv (buffered, written by a background thread)
+void logSwitchState(SimulationContext &ctx);
 void logSwitchState();
 
+// Logs the tick's state hash to hashes.csv (see state_hash.h)
+void logStateHash(SimulationContext &ctx);
+
+// Log ticks firstTick..lastTick that were skipped while no train was active:
+// the same rows logTrainTrace/logSwitchState/logStateHash would have written
+// (no trace rows, as there are no active trains).
+void logIdleTicks(SimulationContext &ctx, int firstTick, int lastTick);
+
+// Flushes and closes the trace/switch logs. Call before exiting.
+void closeLogFiles(SimulationContext &ctx);
+void closeLogFiles();
+
 // Writes summary metrics (total trains, delivered trains)
+void writeMetrics(SimulationContext &ctx);
 void writeMetrics();
 
+// ----------------------------------------------------------------------------
+// BINARY TRACE
+// ----------------------------------------------------------------------------
+// trace.bin layout (native little-endian):
+//   header   : "SRTRACE" magic, version, column count, rows per block
+//   blocks   : per block, the columns stored back to back
+//              tick int32[n] | train id int32[n] | x int32[n] | y int32[n] |
+//              direction uint8[n] | state uint8[n]   (padded to 8 bytes)
+//   index    : per block { uint64 offset, uint32 rows, uint32 first tick }
+//   trailer  : uint64 index offset, uint32 block count, uint32 0, "SRTRIDX" magic
+// ----------------------------------------------------------------------------
+
+// One block of a memory-mapped trace; the pointers alias the mapped file.
+struct TraceBlockView {
+    int rows;
+    const int32_t *tick;
+    const int32_t *train_id;
+    const int32_t *x;
+    const int32_t *y;
+    const uint8_t *direction;
+    const uint8_t *state;
+};
+
+// An open binary trace. Fill with openBinaryTrace(), release with closeBinaryTrace().
+struct BinaryTrace {
+    const unsigned char *base;
+    size_t size;
+    int block_count;
+    long long total_rows;
+    const unsigned char *index;
+};
+
+// Memory-maps a trace.bin and validates its header, index and trailer.
+bool openBinaryTrace(const std::string &path, BinaryTrace &trace);
+
+// Zero-copy column spans for one block (0 <= block < trace.block_count).
+TraceBlockView binaryTraceBlock(const BinaryTrace &trace, int block);
+
+// Unmaps the file.
+void closeBinaryTrace(BinaryTrace &trace);
+
+// Writes a binary trace back out in the trace.csv text format.
+bool convertBinaryTraceToCsv(const std::string &binPath, const std::string &csvPath);
+
 #endif
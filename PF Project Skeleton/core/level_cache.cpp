@@ -0,0 +1,378 @@
+#include "level_cache.h"
+#include "io.h"
+#include "trains.h"
+#include "switches.h"
+#include "grid.h"
+#include "tile_table.h"
+#include "state_hash.h"
+#include "track_distance.h"
+#include "log.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+// ============================================================================
+// LEVEL_CACHE.CPP - .lvlc writer and loader
+// ============================================================================
+
+static const char LEVEL_MAGIC[8] = {'S', 'R', 'L', 'E', 'V', 'E', 'L', 0};
+static const uint32_t LEVEL_VERSION = 1;
+static const int LEVEL_HEADER_SIZE = 64;
+
+// 64-bit FNV-1a
+static uint64_t hashBytes(const unsigned char *p, size_t n) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static size_t padTo8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+// Bytes of everything after the header.
+static size_t levelBodyBytes(size_t tiles, size_t switches, size_t trains, size_t spawns, size_t nameBytes) {
+    size_t n = 0;
+    n += padTo8(tiles) * 2;
+    n += padTo8(switches * 4 * 3);
+    n += padTo8(switches * 16 * 2);
+    n += padTo8(switches) * 2;
+    n += padTo8((switches + 1) * 4);
+    n += padTo8(nameBytes);
+    n += padTo8(trains * 4) * 7;
+    n += padTo8(spawns * 4) * 2;
+    return n;
+}
+
+// ----------------------------------------------------------------------------
+// Writer
+// ----------------------------------------------------------------------------
+static void putBytes(vector<unsigned char> &out, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    out.insert(out.end(), p, p + len);
+}
+
+static void putSection(vector<unsigned char> &out, const void *data, size_t len) {
+    putBytes(out, data, len);
+    out.resize(padTo8(out.size()), 0);
+}
+
+static void putU32(vector<unsigned char> &out, uint32_t v) { putBytes(out, &v, 4); }
+static void putU64(vector<unsigned char> &out, uint64_t v) { putBytes(out, &v, 8); }
+static void putI32(vector<unsigned char> &out, int v) { int32_t w = v; putBytes(out, &w, 4); }
+
+static void putInts(vector<unsigned char> &out, const vector<int> &v, int n) {
+    vector<int32_t> w(v.begin(), v.begin() + n);
+    putSection(out, w.data(), (size_t)n * 4);
+}
+
+bool compileLevelFile(const string &lvlPath, const string &lvlcPath) {
+    MappedFile source;
+    if (!mapFile(lvlPath, source)) {
+        LOG_ERROR("Error: Cannot open level file " << lvlPath);
+        return false;
+    }
+    uint64_t sourceHash = hashBytes(source.data, source.size);
+    uint64_t sourceSize = source.size;
+    unmapFile(source);
+
+    SimulationContext level;
+    if (!loadLevelFile(level, lvlPath)) return false;
+
+    int rows = level.grid_rows, cols = level.grid_cols;
+    int switches = level.total_switches, trains = level.total_trains;
+    int spawns = (int)level.spawn_tiles_x.size();
+
+    vector<uint32_t> nameOffsets(1, 0);
+    string names;
+    for (int s = 0; s < switches; s++) {
+        names += level.switch_name[s];
+        nameOffsets.push_back((uint32_t)names.size());
+    }
+
+    vector<unsigned char> out;
+    out.reserve(LEVEL_HEADER_SIZE + levelBodyBytes((size_t)rows * cols, switches, trains, spawns, names.size()));
+    putBytes(out, LEVEL_MAGIC, 8);
+    putU32(out, LEVEL_VERSION);
+    putU32(out, LEVEL_HEADER_SIZE);
+    putU64(out, sourceHash);
+    putU64(out, sourceSize);
+    putI32(out, rows);
+    putI32(out, cols);
+    putI32(out, level.simulation_seed);
+    putI32(out, switches);
+    putI32(out, trains);
+    putI32(out, spawns);
+    putU32(out, (uint32_t)names.size());
+    putU32(out, 0);
+
+    string tiles;
+    tiles.reserve((size_t)rows * cols);
+    for (int r = 0; r < rows; r++) tiles += level.grid[r];
+    putSection(out, tiles.data(), tiles.size());
+    putSection(out, level.tile_kind.data(), level.tile_kind.size());
+
+    vector<int32_t> xyState;
+    for (int s = 0; s < switches; s++) xyState.push_back(level.switch_x[s]);
+    for (int s = 0; s < switches; s++) xyState.push_back(level.switch_y[s]);
+    for (int s = 0; s < switches; s++) xyState.push_back(level.switch_state[s]);
+    putSection(out, xyState.data(), xyState.size() * 4);
+
+    vector<int32_t> counts;
+    for (int s = 0; s < switches; s++)
+        for (int d = 0; d < 4; d++) counts.push_back(level.switch_k_values[s][d]);
+    for (int s = 0; s < switches; s++)
+        for (int d = 0; d < 4; d++) counts.push_back(level.switch_counters[s][d]);
+    putSection(out, counts.data(), counts.size() * 4);
+
+    putSection(out, level.switch_active.data(), switches);
+    putSection(out, level.switch_is_global.data(), switches);
+    putSection(out, nameOffsets.data(), nameOffsets.size() * 4);
+    putSection(out, names.data(), names.size());
+
+    putInts(out, level.train_spawn_tick, trains);
+    putInts(out, level.train_dest_x, trains);
+    putInts(out, level.train_dest_y, trains);
+    putInts(out, level.train_wait, trains);
+    putInts(out, level.train_priority, trains);
+    putInts(out, level.train_spawn_x, trains);
+    putInts(out, level.train_spawn_y, trains);
+
+    putInts(out, level.spawn_tiles_x, spawns);
+    putInts(out, level.spawn_tiles_y, spawns);
+
+    FILE *f = fopen(lvlcPath.c_str(), "wb");
+    if (!f) {
+        LOG_ERROR("Error: Cannot write " << lvlcPath);
+        return false;
+    }
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) LOG_ERROR("Error: Cannot write " << lvlcPath);
+    return ok;
+}
+
+// ----------------------------------------------------------------------------
+// Loader
+// ----------------------------------------------------------------------------
+// Sequential reader over the mapped image; sizes were validated up front.
+struct ImageCursor {
+    const unsigned char *p;
+};
+
+static const unsigned char *takeSection(ImageCursor &c, size_t len) {
+    const unsigned char *start = c.p;
+    c.p += padTo8(len);
+    return start;
+}
+
+static void takeInts(ImageCursor &c, vector<int> &v, int n) {
+    const unsigned char *p = takeSection(c, (size_t)n * 4);
+    for (int i = 0; i < n; i++) {
+        int32_t w;
+        memcpy(&w, p + (size_t)i * 4, 4);
+        v[i] = w;
+    }
+}
+
+static uint32_t getU32(const unsigned char *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static uint64_t getU64(const unsigned char *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static int getI32(const unsigned char *p) { int32_t v; memcpy(&v, p, 4); return v; }
+
+static bool rejectImage(const string &path, const char *why) {
+    LOG_ERROR("Error: " << path << ": " << why);
+    return false;
+}
+
+bool loadCompiledLevel(SimulationContext &ctx, const string &lvlcPath, const string &sourcePath) {
+    MappedFile image;
+    if (!mapFile(lvlcPath, image)) {
+        LOG_ERROR("Error: Cannot open compiled level " << lvlcPath);
+        return false;
+    }
+
+    const unsigned char *h = image.data;
+    if (image.size < (size_t)LEVEL_HEADER_SIZE || memcmp(h, LEVEL_MAGIC, 8) != 0) {
+        unmapFile(image);
+        return rejectImage(lvlcPath, "not a compiled level");
+    }
+    if (getU32(h + 8) != LEVEL_VERSION || getU32(h + 12) != (uint32_t)LEVEL_HEADER_SIZE) {
+        unmapFile(image);
+        return rejectImage(lvlcPath, "unsupported compiled level version");
+    }
+
+    uint64_t sourceHash = getU64(h + 16);
+    uint64_t sourceSize = getU64(h + 24);
+    int rows = getI32(h + 32), cols = getI32(h + 36), seed = getI32(h + 40);
+    int switches = getI32(h + 44), trains = getI32(h + 48), spawns = getI32(h + 52);
+    uint32_t nameBytes = getU32(h + 56);
+
+    if (rows < 0 || cols < 0 || switches < 0 || trains < 0 || spawns < 0 ||
+        image.size != LEVEL_HEADER_SIZE + levelBodyBytes((size_t)rows * cols, switches, trains, spawns, nameBytes)) {
+        unmapFile(image);
+        return rejectImage(lvlcPath, "truncated or corrupt compiled level");
+    }
+
+    if (!sourcePath.empty()) {
+        MappedFile source;
+        if (!mapFile(sourcePath, source)) {
+            unmapFile(image);
+            LOG_ERROR("Error: Cannot open level file " << sourcePath);
+            return false;
+        }
+        bool current = source.size == sourceSize && hashBytes(source.data, source.size) == sourceHash;
+        unmapFile(source);
+        if (!current) {
+            unmapFile(image);
+            return rejectImage(lvlcPath, "out of date with its .lvl source");
+        }
+    }
+
+    ImageCursor c;
+    c.p = image.data + LEVEL_HEADER_SIZE;
+    size_t tiles = (size_t)rows * cols;
+    const unsigned char *gridChars = takeSection(c, tiles);
+    const unsigned char *kinds = takeSection(c, tiles);
+    const unsigned char *xyState = takeSection(c, (size_t)switches * 4 * 3);
+    const unsigned char *counts = takeSection(c, (size_t)switches * 16 * 2);
+    const unsigned char *active = takeSection(c, switches);
+    const unsigned char *global = takeSection(c, switches);
+    const unsigned char *nameOffsets = takeSection(c, (size_t)(switches + 1) * 4);
+    const unsigned char *names = takeSection(c, nameBytes);
+
+    for (size_t t = 0; t < tiles; t++) {
+        if (kinds[t] >= TILE_KIND_COUNT) {
+            unmapFile(image);
+            return rejectImage(lvlcPath, "invalid tile kind");
+        }
+    }
+    for (int s = 0; s < switches; s++) {
+        if (getU32(nameOffsets + s * 4) > getU32(nameOffsets + (s + 1) * 4) ||
+            getU32(nameOffsets + (s + 1) * 4) > nameBytes) {
+            unmapFile(image);
+            return rejectImage(lvlcPath, "invalid switch name table");
+        }
+    }
+
+    // Coordinates index the grid once loaded; check them against it first
+    bool sane = true;
+    for (int s = 0; s < switches && sane; s++) {
+        int state = getI32(xyState + (size_t)(2 * switches + s) * 4);
+        sane = isGridPositionOrNone(rows, cols, getI32(xyState + (size_t)s * 4),
+                                    getI32(xyState + (size_t)(switches + s) * 4)) &&
+               (state == 0 || state == 1);
+    }
+    ImageCursor tc = c;
+    takeSection(tc, (size_t)trains * 4);  // spawn ticks
+    const unsigned char *destX = takeSection(tc, (size_t)trains * 4);
+    const unsigned char *destY = takeSection(tc, (size_t)trains * 4);
+    takeSection(tc, (size_t)trains * 4);  // waits
+    takeSection(tc, (size_t)trains * 4);  // priorities
+    const unsigned char *spawnX = takeSection(tc, (size_t)trains * 4);
+    const unsigned char *spawnY = takeSection(tc, (size_t)trains * 4);
+    const unsigned char *tilesX = takeSection(tc, (size_t)spawns * 4);
+    const unsigned char *tilesY = takeSection(tc, (size_t)spawns * 4);
+    for (int i = 0; i < trains && sane; i++) {
+        sane = isSaneDestination(getI32(destX + (size_t)i * 4), getI32(destY + (size_t)i * 4)) &&
+               isGridPositionOrNone(rows, cols, getI32(spawnX + (size_t)i * 4), getI32(spawnY + (size_t)i * 4));
+    }
+    for (int k = 0; k < spawns && sane; k++)
+        sane = isGridPosition(rows, cols, getI32(tilesX + (size_t)k * 4), getI32(tilesY + (size_t)k * 4));
+    if (!sane) {
+        unmapFile(image);
+        return rejectImage(lvlcPath, "truncated or corrupt compiled level");
+    }
+
+    // Same starting state as loadLevelFile()
+    ctx.total_trains = 0;
+    ctx.train_count = 0;
+    ctx.current_tick = 0;
+    ctx.simulation_seed = seed;
+
+    resizeGrid(ctx, rows, cols);
+    for (int r = 0; r < rows; r++) ctx.grid[r].assign((const char *)gridChars + (size_t)r * cols, cols);
+    memcpy(ctx.tile_kind.data(), kinds, tiles);
+
+    resizeSwitchArrays(ctx, 0);
+    resizeSwitchArrays(ctx, switches);
+    ctx.total_switches = switches;
+    for (int s = 0; s < switches; s++) {
+        ctx.switch_x[s] = getI32(xyState + (size_t)s * 4);
+        ctx.switch_y[s] = getI32(xyState + (size_t)(switches + s) * 4);
+        ctx.switch_state[s] = getI32(xyState + (size_t)(2 * switches + s) * 4);
+        for (int d = 0; d < 4; d++) {
+            ctx.switch_k_values[s][d] = getI32(counts + (size_t)(s * 4 + d) * 4);
+            ctx.switch_counters[s][d] = getI32(counts + (size_t)((switches + s) * 4 + d) * 4);
+        }
+        ctx.switch_active[s] = active[s];
+        ctx.switch_is_global[s] = global[s];
+        uint32_t from = getU32(nameOffsets + s * 4), to = getU32(nameOffsets + (s + 1) * 4);
+        ctx.switch_name[s].assign((const char *)names + from, to - from);
+    }
+
+    resizeTrainArrays(ctx, 0);
+    resizeTrainArrays(ctx, trains);
+    ctx.total_trains = trains;
+    takeInts(c, ctx.train_spawn_tick, trains);
+    takeInts(c, ctx.train_dest_x, trains);
+    takeInts(c, ctx.train_dest_y, trains);
+    takeInts(c, ctx.train_wait, trains);
+    takeInts(c, ctx.train_priority, trains);
+    takeInts(c, ctx.train_spawn_x, trains);
+    takeInts(c, ctx.train_spawn_y, trains);
+    for (int i = 0; i < trains; i++) ctx.train_id[i] = i;
+
+    ctx.spawn_tiles_x.assign(spawns, 0);
+    ctx.spawn_tiles_y.assign(spawns, 0);
+    takeInts(c, ctx.spawn_tiles_x, spawns);
+    takeInts(c, ctx.spawn_tiles_y, spawns);
+
+    unmapFile(image);
+
+    buildSwitchMap(ctx);
+    rebuildOccupancyIndex(ctx);
+    rebuildSpawnQueue(ctx);
+    buildTrackDistances(ctx);
+    resetStateHash(ctx);
+    return true;
+}
+
+static bool endsWith(const string &s, const string &suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool fileExists(const string &path) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    fclose(f);
+    return true;
+}
+
+bool loadLevel(SimulationContext &ctx, const string &path) {
+    if (endsWith(path, ".lvlc")) {
+        string source = path.substr(0, path.size() - 1);
+        return loadCompiledLevel(ctx, path, fileExists(source) ? source : "");
+    }
+
+    string cached = path + "c";
+    if (fileExists(cached)) {
+        if (loadCompiledLevel(ctx, cached, path)) return true;
+        LOG_WARN("Parsing " << path << " instead (recompile with --compile)");
+    }
+    return loadLevelFile(ctx, path);
+}
+
+// ----------------------------------------------------------------------------
+// DEFAULT-CONTEXT WRAPPERS
+// ----------------------------------------------------------------------------
+bool loadCompiledLevel(const string &lvlcPath, const string &sourcePath) {
+    return loadCompiledLevel(default_context, lvlcPath, sourcePath);
+}
+bool loadLevel(const string &path) { return loadLevel(default_context, path); }
@@ -0,0 +1,43 @@
+#ifndef LEVEL_CACHE_H
+#define LEVEL_CACHE_H
+
+#include <string>
+#include "simulation_state.h"
+
+// ============================================================================
+// LEVEL_CACHE.H - Compiled level images (.lvlc)
+// ============================================================================
+// A .lvlc holds a level as loadLevelFile() leaves it: grid, tile kinds,
+// switch table, spawn tiles and the train schedule. Loading one is a mmap
+// and a handful of copies instead of a text parse.
+//
+// Each image records the FNV-1a hash and size of the .lvl it was compiled
+// from, so a stale image is rejected when the source is available.
+//
+// Layout (native little-endian, sections padded to 8 bytes):
+//   header   : "SRLEVEL" magic, version, header size, source hash, source
+//              size, rows, cols, seed, switch/train/spawn-tile counts, bytes
+//              of switch names
+//   grid     : char[rows * cols] row-major, then tile kind uint8[rows * cols]
+//   switches : x, y, state int32[n] | k values, counters int32[4 * n] |
+//              active, is_global uint8[n] | name offsets uint32[n + 1] | names
+//   trains   : spawn tick, dest x, dest y, wait, priority, spawn x, spawn y
+//              int32[t] each
+//   spawns   : 'S' tile x, y int32[s] each
+// ============================================================================
+
+// Parse lvlPath and write its compiled image to lvlcPath.
+bool compileLevelFile(const std::string &lvlPath, const std::string &lvlcPath);
+
+// Load a compiled image. With a non-empty sourcePath the image is rejected
+// (returns false) unless it was compiled from that file's current contents.
+bool loadCompiledLevel(SimulationContext &ctx, const std::string &lvlcPath, const std::string &sourcePath);
+bool loadCompiledLevel(const std::string &lvlcPath, const std::string &sourcePath);
+
+// Load a level by path: a .lvlc is loaded directly (checked against its .lvl
+// if one sits next to it); for a .lvl, an up-to-date "<path>c" image is used
+// when present, otherwise the text is parsed.
+bool loadLevel(SimulationContext &ctx, const std::string &path);
+bool loadLevel(const std::string &path);
+
+#endif
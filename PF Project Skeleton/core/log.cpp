@@ -0,0 +1,33 @@
+#include "log.h"
+#include <cstdio>
+
+using namespace std;
+
+// ============================================================================
+// LOG.CPP - Log level and line output
+// ============================================================================
+
+int log_level = LOG_LEVEL_INFO;
+
+static const char *LEVEL_NAMES[] = {"error", "warn", "info", "debug", "trace"};
+
+bool parseLogLevel(const string &name, int &level) {
+    for (int l = LOG_LEVEL_ERROR; l <= LOG_LEVEL_TRACE; l++) {
+        if (name == LEVEL_NAMES[l]) {
+            level = l;
+            return true;
+        }
+    }
+    return false;
+}
+
+void logWrite(int level, const string &message) {
+    // One fwrite per line, so lines from different threads do not mix
+    string line;
+    if (level == LOG_LEVEL_DEBUG) line = "DEBUG: ";
+    else if (level == LOG_LEVEL_TRACE) line = "TRACE: ";
+    line += message;
+    line += '\n';
+    fwrite(line.data(), 1, line.size(), stdout);
+    if (level == LOG_LEVEL_ERROR) fflush(stdout);
+}
@@ -0,0 +1,80 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <string>
+#include <sstream>
+
+// ============================================================================
+// LOG.H - Leveled logging to stdout
+// ============================================================================
+//     LOG_INFO("Level loaded: " << rows << "x" << cols);
+//
+// A message is written (one line, no flush) when its level is at or below
+// log_level, which defaults to LOG_LEVEL_INFO and is set with --log-level.
+// Debug and trace lines are prefixed "DEBUG: " / "TRACE: "; the others are
+// written as given. Errors flush stdout.
+//
+// Levels above SR_LOG_MAX_LEVEL are removed at compile time: their macros
+// expand to nothing, so the message expression is never built. Release
+// builds (NDEBUG, make RELEASE=1) keep up to LOG_LEVEL_INFO, other builds
+// keep everything; -DSR_LOG_MAX_LEVEL=<n> overrides either.
+// ============================================================================
+
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN  1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_DEBUG 3
+#define LOG_LEVEL_TRACE 4
+
+#ifndef SR_LOG_MAX_LEVEL
+#ifdef NDEBUG
+#define SR_LOG_MAX_LEVEL LOG_LEVEL_INFO
+#else
+#define SR_LOG_MAX_LEVEL LOG_LEVEL_TRACE
+#endif
+#endif
+
+// Runtime threshold (LOG_LEVEL_*)
+extern int log_level;
+
+// "error", "warn", "info", "debug" or "trace"; returns false for anything else.
+bool parseLogLevel(const std::string &name, int &level);
+
+// Write one line at the given level (use the macros instead).
+void logWrite(int level, const std::string &message);
+
+#define SR_LOG_AT(level, expr) do { \
+        if ((level) <= log_level) { \
+            std::ostringstream logLine_; \
+            logLine_ << expr; \
+            logWrite((level), logLine_.str()); \
+        } \
+    } while (0)
+
+#define LOG_ERROR(expr) SR_LOG_AT(LOG_LEVEL_ERROR, expr)
+
+#if SR_LOG_MAX_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(expr) SR_LOG_AT(LOG_LEVEL_WARN, expr)
+#else
+#define LOG_WARN(expr) do {} while (0)
+#endif
+
+#if SR_LOG_MAX_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(expr) SR_LOG_AT(LOG_LEVEL_INFO, expr)
+#else
+#define LOG_INFO(expr) do {} while (0)
+#endif
+
+#if SR_LOG_MAX_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(expr) SR_LOG_AT(LOG_LEVEL_DEBUG, expr)
+#else
+#define LOG_DEBUG(expr) do {} while (0)
+#endif
+
+#if SR_LOG_MAX_LEVEL >= LOG_LEVEL_TRACE
+#define LOG_TRACE(expr) SR_LOG_AT(LOG_LEVEL_TRACE, expr)
+#else
+#define LOG_TRACE(expr) do {} while (0)
+#endif
+
+#endif
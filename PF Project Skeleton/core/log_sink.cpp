@@ -0,0 +1,213 @@
+#include "log_sink.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+// ============================================================================
+// LOG_SINK.CPP - Background writer for trace/switch logs
+// ============================================================================
+
+// Size of one in-memory buffer before it is handed to the writer thread
+static const size_t LOG_BUFFER_SIZE = 1 << 20;
+
+// Producer blocks once this many full buffers are waiting to be written
+static const size_t LOG_MAX_QUEUED = 16;
+
+// Stream slots are a fixed table so that opening a stream never moves the
+// slots other threads are writing through.
+static const int LOG_MAX_STREAMS = 1024;
+
+struct LogJob {
+    int stream;
+    vector<char> *data;
+};
+
+static FILE *streamFiles[LOG_MAX_STREAMS];
+static vector<char> *streamBuffers[LOG_MAX_STREAMS];
+static int streamPending[LOG_MAX_STREAMS];  // queued or in-flight buffers
+
+static deque<LogJob> jobQueue;
+static vector<vector<char> *> freeBuffers;
+static int jobsInFlight = 0;
+static bool writerStop = false;
+static bool writerStarted = false;
+static bool exitHookInstalled = false;
+
+static mutex queueMutex;
+static condition_variable jobReady;
+static condition_variable jobDone;
+static thread writerThread;
+
+// ----------------------------------------------------------------------------
+// Writer thread: drain the queue until asked to stop.
+// ----------------------------------------------------------------------------
+static void writerLoop() {
+    unique_lock<mutex> lock(queueMutex);
+    while (true) {
+        jobReady.wait(lock, [] { return writerStop || !jobQueue.empty(); });
+        if (jobQueue.empty()) {
+            if (writerStop) break;
+            continue;
+        }
+
+        LogJob job = jobQueue.front();
+        jobQueue.pop_front();
+        jobsInFlight++;
+        FILE *f = streamFiles[job.stream];
+        lock.unlock();
+
+        if (f && !job.data->empty()) {
+            fwrite(job.data->data(), 1, job.data->size(), f);
+        }
+        job.data->clear();
+
+        lock.lock();
+        freeBuffers.push_back(job.data);
+        streamPending[job.stream]--;
+        jobsInFlight--;
+        jobDone.notify_all();
+    }
+}
+
+static vector<char> *takeBuffer() {
+    // queueMutex must be held
+    vector<char> *buf;
+    if (!freeBuffers.empty()) {
+        buf = freeBuffers.back();
+        freeBuffers.pop_back();
+    } else {
+        buf = new vector<char>();
+        buf->reserve(LOG_BUFFER_SIZE);
+    }
+    return buf;
+}
+
+// Queue a stream's current buffer and give it a fresh one.
+static void submitBuffer(int stream) {
+    unique_lock<mutex> lock(queueMutex);
+    jobDone.wait(lock, [] { return jobQueue.size() < LOG_MAX_QUEUED; });
+
+    LogJob job;
+    job.stream = stream;
+    job.data = streamBuffers[stream];
+    jobQueue.push_back(job);
+    streamPending[stream]++;
+    streamBuffers[stream] = takeBuffer();
+    jobReady.notify_one();
+}
+
+static void closeAtExit() {
+    closeLogStreams();
+}
+
+// Give an open file a stream slot (it is closed if none is free).
+static int openStreamFile(FILE *f) {
+    if (!f) return -1;
+
+    lock_guard<mutex> lock(queueMutex);
+    int slot = -1;
+    for (int s = 0; s < LOG_MAX_STREAMS && slot == -1; s++)
+        if (!streamFiles[s]) slot = s;
+    if (slot == -1) {
+        fclose(f);
+        return -1;
+    }
+
+    if (!writerStarted) {
+        writerStop = false;
+        writerThread = thread(writerLoop);
+        writerStarted = true;
+        if (!exitHookInstalled) {
+            atexit(closeAtExit);
+            exitHookInstalled = true;
+        }
+    }
+
+    streamFiles[slot] = f;
+    streamBuffers[slot] = takeBuffer();
+    streamPending[slot] = 0;
+    return slot;
+}
+
+int openLogStream(const string &path) {
+    return openStreamFile(fopen(path.c_str(), "wb"));
+}
+
+int appendLogStream(const string &path) {
+    return openStreamFile(fopen(path.c_str(), "ab"));
+}
+
+void logStreamWrite(int stream, const char *data, int len) {
+    if (stream < 0 || stream >= LOG_MAX_STREAMS || len <= 0) return;
+
+    vector<char> *buf = streamBuffers[stream];
+    if (!buf) return;
+    if (buf->size() + len > LOG_BUFFER_SIZE && !buf->empty()) {
+        submitBuffer(stream);
+        buf = streamBuffers[stream];
+    }
+    buf->insert(buf->end(), data, data + len);
+}
+
+// Wait until the writer has drained the queue (queueMutex held by lock).
+static void waitForWriter(unique_lock<mutex> &lock) {
+    jobDone.wait(lock, [] { return jobQueue.empty() && jobsInFlight == 0; });
+}
+
+void flushLogStream(int stream) {
+    if (stream < 0 || stream >= LOG_MAX_STREAMS || !streamBuffers[stream]) return;
+    if (!streamBuffers[stream]->empty()) submitBuffer(stream);
+
+    unique_lock<mutex> lock(queueMutex);
+    jobDone.wait(lock, [stream] { return streamPending[stream] == 0; });
+    fflush(streamFiles[stream]);
+}
+
+void closeLogStream(int stream) {
+    if (stream < 0 || stream >= LOG_MAX_STREAMS || !streamBuffers[stream]) return;
+    flushLogStream(stream);
+
+    lock_guard<mutex> lock(queueMutex);
+    fclose(streamFiles[stream]);
+    streamFiles[stream] = NULL;
+    freeBuffers.push_back(streamBuffers[stream]);
+    streamBuffers[stream] = NULL;
+}
+
+void flushLogStreams() {
+    for (int s = 0; s < LOG_MAX_STREAMS; s++) {
+        if (streamBuffers[s] && !streamBuffers[s]->empty()) submitBuffer(s);
+    }
+
+    unique_lock<mutex> lock(queueMutex);
+    waitForWriter(lock);
+    for (int s = 0; s < LOG_MAX_STREAMS; s++) {
+        if (streamFiles[s]) fflush(streamFiles[s]);
+    }
+}
+
+void closeLogStreams() {
+    if (!writerStarted) return;
+
+    for (int s = 0; s < LOG_MAX_STREAMS; s++) {
+        if (streamFiles[s]) closeLogStream(s);
+    }
+
+    {
+        lock_guard<mutex> lock(queueMutex);
+        writerStop = true;
+    }
+    jobReady.notify_all();
+    writerThread.join();
+    writerStarted = false;
+
+    for (int i = 0; i < (int)freeBuffers.size(); i++) delete freeBuffers[i];
+    freeBuffers.clear();
+}
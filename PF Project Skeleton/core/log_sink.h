@@ -0,0 +1,42 @@
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include <string>
+
+// ============================================================================
+// LOG_SINK.H - Buffered output streams drained by a background writer thread
+// ============================================================================
+// Each stream keeps its file open for the whole run. Writes are appended to a
+// large in-memory buffer; full buffers are handed to a single writer thread so
+// the tick loop never waits on open/close/write syscalls. Buffers of one stream
+// are written in the order they were filled.
+//
+// Streams may be opened, written and closed from different threads as long
+// as each stream is written by one thread at a time.
+// ============================================================================
+
+// Open (truncate) a file for buffered output.
+// Returns a stream id, or -1 if the file cannot be opened.
+int openLogStream(const std::string &path);
+
+// Open a file for buffered output at its end, creating it if needed.
+int appendLogStream(const std::string &path);
+
+// Append len bytes to a stream's buffer.
+void logStreamWrite(int stream, const char *data, int len);
+
+// Hand a stream's partially filled buffer to the writer and wait until it
+// has been written.
+void flushLogStream(int stream);
+
+// Flush and close one stream.
+void closeLogStream(int stream);
+
+// Hand every partially filled buffer to the writer and wait until all
+// queued data has been written to the files.
+void flushLogStreams();
+
+// Flush and close every stream and stop the writer thread.
+void closeLogStreams();
+
+#endif
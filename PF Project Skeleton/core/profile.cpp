@@ -0,0 +1,114 @@
+#include "profile.h"
+#include "simulation_state.h"
+#include <cstdio>
+#include <string>
+
+using namespace std;
+
+// ============================================================================
+// PROFILE.CPP - Phase histograms and the profile.txt summary
+// ============================================================================
+
+#ifdef SR_PROFILE
+
+static const char *PHASE_NAMES[PROFILE_PHASE_COUNT] = {
+    "spawn", "routes", "collisions", "move", "arrivals", "state hash", "logging", "tick (total)"
+};
+
+static const char *COUNTER_NAMES[PROFILE_COUNTER_COUNT] = {
+    "trains spawned", "spawns blocked", "conflicts resolved", "trains moved", "trains arrived",
+    "ticks fast-forwarded"
+};
+
+ProfileData::ProfileData() {
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        phases[p].calls = 0;
+        phases[p].total_ns = 0;
+        phases[p].max_ns = 0;
+        for (int b = 0; b < PROFILE_BUCKETS; b++) phases[p].buckets[b] = 0;
+    }
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) counters[c] = 0;
+}
+
+void profileRecord(ProfileData &profile, int phase, unsigned long long ns) {
+    ProfilePhaseStats &s = profile.phases[phase];
+    s.calls++;
+    s.total_ns += ns;
+    if (ns > s.max_ns) s.max_ns = ns;
+
+    int bucket = 0;
+    while (bucket + 1 < PROFILE_BUCKETS && (ns >> (bucket + 1)) != 0) bucket++;
+    s.buckets[bucket]++;
+}
+
+// Upper bound (ns) of the bucket holding the given fraction of the calls.
+static double percentileNs(const ProfilePhaseStats &s, double fraction) {
+    unsigned long long want = (unsigned long long)(fraction * s.calls + 0.5);
+    if (want == 0) want = 1;
+    unsigned long long seen = 0;
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        seen += s.buckets[b];
+        if (seen >= want) return (double)((2ULL << b) < s.max_ns ? (2ULL << b) : s.max_ns);
+    }
+    return (double)s.max_ns;
+}
+
+// Bucket bounds as "512ns", "4us", "2ms"...
+static string formatNs(unsigned long long ns) {
+    char buf[32];
+    if (ns < 1000ULL) snprintf(buf, sizeof(buf), "%lluns", ns);
+    else if (ns < 1000000ULL) snprintf(buf, sizeof(buf), "%.3gus", ns / 1e3);
+    else if (ns < 1000000000ULL) snprintf(buf, sizeof(buf), "%.3gms", ns / 1e6);
+    else snprintf(buf, sizeof(buf), "%.3gs", ns / 1e9);
+    return buf;
+}
+
+void writeProfile(const SimulationContext &ctx) {
+    const ProfileData &profile = ctx.profile;
+    FILE *f = fopen((ctx.output_dir + "/profile.txt").c_str(), "w");
+    if (!f) return;
+
+    const ProfilePhaseStats &tick = profile.phases[PROFILE_TICK];
+    fprintf(f, "Tick Phase Profile\n");
+    fprintf(f, "Ticks simulated: %llu (+%llu fast-forwarded), %d trains, grid %dx%d\n\n",
+            tick.calls, profile.counters[PROFILE_IDLE_TICKS], ctx.total_trains, ctx.grid_rows, ctx.grid_cols);
+
+    // Percentiles are bucket upper bounds, so they overstate by up to 2x
+    fprintf(f, "%-14s %10s %12s %7s %11s %11s %11s %11s %11s\n", "Phase", "calls", "total ms", "share",
+            "mean us", "p50 us <=", "p90 us <=", "p99 us <=", "max us");
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        const ProfilePhaseStats &s = profile.phases[p];
+        double share = tick.total_ns ? 100.0 * s.total_ns / tick.total_ns : 0.0;
+        double mean = s.calls ? s.total_ns / 1e3 / s.calls : 0.0;
+        fprintf(f, "%-14s %10llu %12.3f %6.1f%% %11.3f %11.3f %11.3f %11.3f %11.3f\n", PHASE_NAMES[p], s.calls,
+                s.total_ns / 1e6, share, mean, percentileNs(s, 0.50) / 1e3, percentileNs(s, 0.90) / 1e3,
+                percentileNs(s, 0.99) / 1e3, s.max_ns / 1e3);
+    }
+
+    fprintf(f, "\nCounters\n");
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+        fprintf(f, "%-22s %14llu", COUNTER_NAMES[c], profile.counters[c]);
+        if (tick.calls && c != PROFILE_IDLE_TICKS) fprintf(f, "  (%.2f per tick)", (double)profile.counters[c] / tick.calls);
+        fprintf(f, "\n");
+    }
+
+    fprintf(f, "\nHistograms (calls per duration bucket)\n");
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        const ProfilePhaseStats &s = profile.phases[p];
+        if (s.calls == 0) continue;
+        fprintf(f, "%s\n", PHASE_NAMES[p]);
+        for (int b = 0; b < PROFILE_BUCKETS; b++) {
+            if (s.buckets[b] == 0) continue;
+            string range = (b == 0 ? string("0ns") : formatNs(1ULL << b)) + " - " + formatNs(2ULL << b);
+            int bar = (int)(50.0 * s.buckets[b] / s.calls + 0.5);
+            fprintf(f, "  %-18s %10llu  %s\n", range.c_str(), s.buckets[b], string(bar, '#').c_str());
+        }
+    }
+    fclose(f);
+}
+
+#else
+
+void writeProfile(const SimulationContext &) {}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// ============================================================================
+// PROFILE.H - Per-phase tick timing (built with -DSR_PROFILE)
+// ============================================================================
+// With SR_PROFILE defined (make PROFILE=1), simulateOneTick() times each
+// phase with the monotonic clock into a log2 histogram per phase, and the
+// tick code bumps event counters (trains moved, conflicts, blocked spawns,
+// ...). writeMetrics() then writes the summary to <output_dir>/profile.txt.
+//
+// Without SR_PROFILE the macros below expand to the bare statement, the
+// context has no profile member and writeProfile() does nothing.
+// ============================================================================
+
+struct SimulationContext;
+
+enum ProfilePhase {
+    PROFILE_SPAWN,
+    PROFILE_ROUTES,
+    PROFILE_COLLISIONS,
+    PROFILE_MOVE,
+    PROFILE_ARRIVALS,
+    PROFILE_HASH,
+    PROFILE_LOG,
+    PROFILE_TICK,          // the whole of simulateOneTick()
+    PROFILE_PHASE_COUNT
+};
+
+enum ProfileCounter {
+    PROFILE_SPAWNED,          // trains placed on their spawn tile
+    PROFILE_SPAWNS_BLOCKED,   // due trains kept waiting (per train per tick)
+    PROFILE_CONFLICTS,        // claims lost in detectCollisions()
+    PROFILE_TRAINS_MOVED,     // trains that left their tile
+    PROFILE_ARRIVED,          // trains that finished
+    PROFILE_IDLE_TICKS,       // ticks skipped by fastForwardIdleTicks()
+    PROFILE_COUNTER_COUNT
+};
+
+#ifdef SR_PROFILE
+
+#include <chrono>
+
+// Bucket k counts samples of [2^k, 2^(k+1)) ns (bucket 0 also takes 0 ns)
+const int PROFILE_BUCKETS = 40;
+
+struct ProfilePhaseStats {
+    unsigned long long calls;
+    unsigned long long total_ns;
+    unsigned long long max_ns;
+    unsigned long long buckets[PROFILE_BUCKETS];
+};
+
+struct ProfileData {
+    ProfilePhaseStats phases[PROFILE_PHASE_COUNT];
+    unsigned long long counters[PROFILE_COUNTER_COUNT];
+
+    ProfileData();
+};
+
+inline unsigned long long profileNow() {
+    return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void profileRecord(ProfileData &profile, int phase, unsigned long long ns);
+
+#define PROFILE_PHASE(ctx, phase, stmt) do { \
+        unsigned long long profileStart_ = profileNow(); \
+        stmt; \
+        profileRecord((ctx).profile, (phase), profileNow() - profileStart_); \
+    } while (0)
+#define PROFILE_COUNT(ctx, counter, n) ((ctx).profile.counters[(counter)] += (unsigned long long)(n))
+
+#else
+
+#define PROFILE_PHASE(ctx, phase, stmt) do { stmt; } while (0)
+#define PROFILE_COUNT(ctx, counter, n) ((void)0)
+
+#endif
+
+// Write <output_dir>/profile.txt (only with SR_PROFILE).
+void writeProfile(const SimulationContext &ctx);
+
+#endif
@@ -4,7 +4,9 @@
 #include "switches.h"
 #include "io.h"
 #include "grid.h"
-#include <iostream>
+#include "state_hash.h"
+#include "profile.h"
+#include "log.h"
 #include <cstdlib>
 
 // ============================================================================
@@ -14,12 +16,11 @@
 // ----------------------------------------------------------------------------
 // INITIALIZE SIMULATION
 // ----------------------------------------------------------------------------
-void initializeSimulation() {
-    // If specific setup beyond state reset is needed (e.g. seeding)
-    if (simulation_seed != 0) {
-        srand(simulation_seed);
-    }
- 
+void initializeSimulation(SimulationContext &ctx) {
+    // Each context keeps its own seed state (from SEED) instead of sharing
+    // rand(). No tick phase draws from it yet; it is checkpointed and hashed
+    // so that a future random phase stays reproducible.
+    ctx.rng_state = (ctx.simulation_seed != 0) ? (unsigned int)ctx.simulation_seed : 1u;
 }
 
 // ----------------------------------------------------------------------------
@@ -27,55 +28,99 @@ void initializeSimulation() {
 // ----------------------------------------------------------------------------
 // Follows the "Tick Timing" order from PDF Page 3
 // ----------------------------------------------------------------------------
-void simulateOneTick() {
-    current_tick++;
-    std::cout << "simulateOneTick(): advancing to tick " << current_tick << std::endl;
+void simulateOneTick(SimulationContext &ctx) {
+#ifdef SR_PROFILE
+    unsigned long long tickStart = profileNow();
+#endif
+    ctx.current_tick++;
+    LOG_TRACE("simulateOneTick(): advancing to tick " << ctx.current_tick);
 
     // 1. Spawn: Align trains scheduled for this tick
-    spawnTrainsForTick();
+    PROFILE_PHASE(ctx, PROFILE_SPAWN, spawnTrainsForTick(ctx));
 
     // 2. Route Determination: Compute next tile for every train
-    determineAllRoutes();
+    PROFILE_PHASE(ctx, PROFILE_ROUTES, determineAllRoutes(ctx));
 
 
     // 5. Collision Detection & Movement
-    // Detect conflicts (Manhattan priority) and update positions
-    detectCollisions();
-    moveAllTrains();
+    // Detect conflicts (track distance priority) and update positions
+    PROFILE_PHASE(ctx, PROFILE_COLLISIONS, detectCollisions(ctx));
+    PROFILE_PHASE(ctx, PROFILE_MOVE, moveAllTrains(ctx));
 
 
 
     // 7. Arrivals: Check if trains reached destination
-    checkArrivals();
+    PROFILE_PHASE(ctx, PROFILE_ARRIVALS, checkArrivals(ctx));
+
+    // 8. State hash: fold in this tick's changes
+    PROFILE_PHASE(ctx, PROFILE_HASH, updateStateHash(ctx));
 
 
 
     // 9. Logging & Output
     // PDF: "At each tick, print grid state to terminal"
     // Also log to CSV files
-    logTrainTrace();
-    logSwitchState();
+#ifdef SR_PROFILE
+    unsigned long long logStart = profileNow();
+#endif
+    logTrainTrace(ctx);
+    logSwitchState(ctx);
+    logStateHash(ctx);
+#ifdef SR_PROFILE
+    unsigned long long tickEnd = profileNow();
+    profileRecord(ctx.profile, PROFILE_LOG, tickEnd - logStart);
+    profileRecord(ctx.profile, PROFILE_TICK, tickEnd - tickStart);
+#endif
     
     // Optional: Print ASCII grid to console (Member A requirement)
     // We can call a helper function from io.h or do it here. 
     // Usually handled by the main loop or io module.
 }
 
+// ----------------------------------------------------------------------------
+// FAST-FORWARD
+// ----------------------------------------------------------------------------
+int fastForwardIdleTicks(SimulationContext &ctx, int maxTicks) {
+    if (ctx.active_trains > 0 || !ctx.spawn_pending.empty()) return 0;
+    if (ctx.spawn_cursor >= (int)ctx.spawn_order.size()) return 0;
+
+    // The next spawn happens on tick nextSpawn; ticks before it are idle
+    int nextSpawn = ctx.train_spawn_tick[ctx.spawn_order[ctx.spawn_cursor]];
+    int skip = nextSpawn - 1 - ctx.current_tick;
+    if (maxTicks >= 0 && skip > maxTicks) skip = maxTicks;
+    if (skip <= 0) return 0;
+
+    LOG_DEBUG("fastForwardIdleTicks(): no active trains, skipping ticks "
+              << (ctx.current_tick + 1) << "-" << (ctx.current_tick + skip));
+    logIdleTicks(ctx, ctx.current_tick + 1, ctx.current_tick + skip);
+    ctx.current_tick += skip;
+    PROFILE_COUNT(ctx, PROFILE_IDLE_TICKS, skip);
+    return skip;
+}
+
 // ----------------------------------------------------------------------------
 // CHECK IF SIMULATION IS COMPLETE
 // ----------------------------------------------------------------------------
-bool isSimulationComplete() {
+bool isSimulationComplete(const SimulationContext &ctx) {
     // Simulation is done if:
     // 1. No trains are currently active on the map
     // 2. All trains from the file have passed their spawn time
-    
-    for (int i = 0; i < total_trains; i++) {
-        // If a train is active, we are not done
-        if (train_active[i]) return false;
+    if (ctx.active_trains > 0) return false;
 
-        // If a train hasn't spawned yet (and hasn't finished), we are not done
-        if (!train_finished[i] && train_spawn_tick[i] > current_tick) return false;
+    // Trains from spawn_cursor on are the only ones that can still have a
+    // spawn tick after current_tick (spawn_order is sorted by spawn tick)
+    for (int k = ctx.spawn_cursor; k < (int)ctx.spawn_order.size(); k++) {
+        int i = ctx.spawn_order[k];
+        if (!ctx.train_finished[i] && ctx.train_spawn_tick[i] > ctx.current_tick) return false;
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+// ----------------------------------------------------------------------------
+// DEFAULT-CONTEXT WRAPPERS
+// ----------------------------------------------------------------------------
+void initializeSimulation() { initializeSimulation(default_context); }
+void simulateOneTick() { simulateOneTick(default_context); }
+int fastForwardIdleTicks(int maxTicks) { return fastForwardIdleTicks(default_context, maxTicks); }
+bool isSimulationComplete() { return isSimulationComplete(default_context); }
@@ -1,26 +1,41 @@
 #ifndef SIMULATION_H
 #define SIMULATION_H
 
+#include "simulation_state.h"
+
 // ============================================================================
 // SIMULATION.H - Simulation tick logic
 // ============================================================================
+// Each function takes the SimulationContext it advances; the overloads
+// without one operate on default_context.
+// ============================================================================
 
 // ----------------------------------------------------------------------------
 // MAIN SIMULATION FUNCTION
 // ----------------------------------------------------------------------------
 // Run one simulation tick.
+void simulateOneTick(SimulationContext &ctx);
 void simulateOneTick();
 
+// Skip ticks on which nothing can happen: while no train is active and none
+// is waiting to spawn, jump to the tick before the next scheduled spawn.
+// The skipped ticks are still logged. Skips at most maxTicks ticks (no limit
+// if negative) and returns the number skipped.
+int fastForwardIdleTicks(SimulationContext &ctx, int maxTicks);
+int fastForwardIdleTicks(int maxTicks);
+
 // ----------------------------------------------------------------------------
 // INITIALIZATION
 // ----------------------------------------------------------------------------
-// Initialize the simulation after loading a level.
+// Initialize the simulation after loading a level (seeds the context's RNG).
+void initializeSimulation(SimulationContext &ctx);
 void initializeSimulation();
 
 // ----------------------------------------------------------------------------
 // UTILITY
 // ----------------------------------------------------------------------------
 // True if all trains are delivered or crashed.
+bool isSimulationComplete(const SimulationContext &ctx);
 bool isSimulationComplete();
 
 #endif
@@ -1,98 +1,167 @@
 #include "simulation_state.h"
 
-char grid[MAX_ROWS][MAX_COLS];
-int grid_rows = 0;
-int grid_cols = 0;
+using namespace std;
+
+SimulationContext::SimulationContext()
+    : grid_rows(0), grid_cols(0),
+      train_count(0), total_trains(0),
+      total_switches(0),
+      active_trains(0),
+      collision_pass(0),
+      spawn_cursor(0),
+      parallel_min_trains(4096),
+      track_slots(0), track_fields(0),
+      trains_hash(0), switches_hash(0),
+      current_tick(0), simulation_seed(0), rng_state(1),
+      output_dir("out"), trace_format(0), trace_stream(-1), switch_stream(-1), hash_stream(-1),
+      bin_offset(0) {
+}
+
+SimulationContext default_context;
+
+// Global names for the default context's fields
+vector<string> &grid = default_context.grid;
+int &grid_rows = default_context.grid_rows;
+int &grid_cols = default_context.grid_cols;
 
 // TRAINS
-int train_count = 0;  // FIXED: Added missing variable (required by app.cpp)
-
-int train_id[MAX_TRAINS];
-int train_x[MAX_TRAINS];
-int train_y[MAX_TRAINS];
-int train_direction[MAX_TRAINS];
-int train_color[MAX_TRAINS];
-int train_spawn_tick[MAX_TRAINS];
-bool train_active[MAX_TRAINS];
-bool train_finished[MAX_TRAINS];
-int train_arrival_tick[MAX_TRAINS];
-
-int train_next_x[MAX_TRAINS];
-int train_next_y[MAX_TRAINS];
-int train_dest_x[MAX_TRAINS];
-int train_dest_y[MAX_TRAINS];
-int train_prev_x[MAX_TRAINS];
-int train_prev_y[MAX_TRAINS];
-
-int total_trains = 0;
+int &train_count = default_context.train_count;  // FIXED: Added missing variable (required by app.cpp)
+
+vector<int> &train_id = default_context.train_id;
+vector<int> &train_x = default_context.train_x;
+vector<int> &train_y = default_context.train_y;
+vector<int> &train_direction = default_context.train_direction;
+vector<int> &train_color = default_context.train_color;
+vector<int> &train_spawn_tick = default_context.train_spawn_tick;
+vector<char> &train_active = default_context.train_active;
+vector<char> &train_finished = default_context.train_finished;
+vector<int> &train_arrival_tick = default_context.train_arrival_tick;
+
+vector<int> &train_next_x = default_context.train_next_x;
+vector<int> &train_next_y = default_context.train_next_y;
+vector<int> &train_dest_x = default_context.train_dest_x;
+vector<int> &train_dest_y = default_context.train_dest_y;
+vector<int> &train_prev_x = default_context.train_prev_x;
+vector<int> &train_prev_y = default_context.train_prev_y;
+
+int &total_trains = default_context.total_trains;
+
+vector<int> &train_spawn_x = default_context.train_spawn_x;
+vector<int> &train_spawn_y = default_context.train_spawn_y;
+
+vector<int> &train_wait = default_context.train_wait;
+vector<int> &train_priority = default_context.train_priority;
 
 // SWITCHES
-int switch_x[MAX_SWITCHES];
-int switch_y[MAX_SWITCHES];
-int switch_state[MAX_SWITCHES];
-bool switch_active[MAX_SWITCHES];
-bool switch_is_global[MAX_SWITCHES];
+int &total_switches = default_context.total_switches;
+vector<string> &switch_name = default_context.switch_name;
+vector<int> &switch_x = default_context.switch_x;
+vector<int> &switch_y = default_context.switch_y;
+vector<int> &switch_state = default_context.switch_state;
+vector<char> &switch_active = default_context.switch_active;
+vector<char> &switch_is_global = default_context.switch_is_global;
 
-int switch_k_values[MAX_SWITCHES][4];
-int switch_counters[MAX_SWITCHES][4];
-bool switch_flip_queued[MAX_SWITCHES];
+vector<array<int, 4> > &switch_k_values = default_context.switch_k_values;
+vector<array<int, 4> > &switch_counters = default_context.switch_counters;
+vector<char> &switch_flip_queued = default_context.switch_flip_queued;
+
+// OCCUPANCY
+vector<int> &tile_occupancy = default_context.tile_occupancy;
 
 // SIMULATION
-int current_tick = 0;
-int simulation_seed = 0;
+int &current_tick = default_context.current_tick;
+int &simulation_seed = default_context.simulation_seed;
 
-void initializeSimulationState() {
-    grid_rows = 0;
-    grid_cols = 0;
+void resizeGrid(SimulationContext &ctx, int rows, int cols) {
+    if (rows < 0) rows = 0;
+    if (cols < 0) cols = 0;
+
+    ctx.grid_rows = rows;
+    ctx.grid_cols = cols;
 
     // Initialize grid with dots
-    for (int r = 0; r < MAX_ROWS; r++) {
-        for (int c = 0; c < MAX_COLS; c++) {
-            grid[r][c] = '.';
-        }
-    }
+    ctx.grid.assign(rows, string(cols, '.'));
+    ctx.tile_occupancy.assign((size_t)rows * cols, 0);
+    ctx.tile_kind.assign((size_t)rows * cols, 0);
+    ctx.tile_switch.assign((size_t)rows * cols, -1);
+}
+
+void resizeTrainArrays(SimulationContext &ctx, int count) {
+    if (count < 0) count = 0;
+
+    ctx.train_id.resize(count, -1);
+    ctx.train_active.resize(count, false);
+    ctx.train_finished.resize(count, false);
 
-    total_trains = 0;
-    train_count = 0;  // FIXED: Initialize train_count
+    ctx.train_x.resize(count, -1);
+    ctx.train_y.resize(count, -1);
 
-    for (int i = 0; i < MAX_TRAINS; i++) {
-        train_id[i] = -1;
-        train_active[i] = false;
-        train_finished[i] = false;
+    ctx.train_next_x.resize(count, -1);
+    ctx.train_next_y.resize(count, -1);
 
-        train_x[i] = -1;
-        train_y[i] = -1;
+    ctx.train_prev_x.resize(count, -1);
+    ctx.train_prev_y.resize(count, -1);
 
-        train_next_x[i] = -1;
-        train_next_y[i] = -1;
+    ctx.train_dest_x.resize(count, -1);
+    ctx.train_dest_y.resize(count, -1);
 
-        train_prev_x[i] = -1;
-        train_prev_y[i] = -1;
+    ctx.train_spawn_x.resize(count, -1);
+    ctx.train_spawn_y.resize(count, -1);
 
-        train_dest_x[i] = -1;
-        train_dest_y[i] = -1;
+    ctx.train_direction.resize(count, 0);
+    ctx.train_color.resize(count, 0);
+    ctx.train_spawn_tick.resize(count, 0);
+    ctx.train_arrival_tick.resize(count, -1);
 
-        train_direction[i] = 0;
-        train_color[i] = 0;
-        train_spawn_tick[i] = 0;
-    }
+    ctx.train_wait.resize(count, 0);
+    ctx.train_priority.resize(count, 0);
+}
 
-    for (int i = 0; i < MAX_SWITCHES; i++) {
-        switch_active[i] = false;
-        switch_flip_queued[i] = false;
+void resizeSwitchArrays(SimulationContext &ctx, int count) {
+    if (count < 0) count = 0;
 
-        switch_state[i] = 0;
-        switch_x[i] = -1;
-        switch_y[i] = -1;
+    array<int, 4> zeros = {{0, 0, 0, 0}};
+
+    ctx.switch_name.resize(count);
+    ctx.switch_active.resize(count, false);
+    ctx.switch_flip_queued.resize(count, false);
+
+    ctx.switch_state.resize(count, 0);
+    ctx.switch_x.resize(count, -1);
+    ctx.switch_y.resize(count, -1);
+
+    ctx.switch_is_global.resize(count, false);
+
+    ctx.switch_k_values.resize(count, zeros);
+    ctx.switch_counters.resize(count, zeros);
+}
+
+void initializeSimulationState(SimulationContext &ctx) {
+    resizeGrid(ctx, 0, 0);
+
+    ctx.total_trains = 0;
+    ctx.train_count = 0;  // FIXED: Initialize train_count
+    resizeTrainArrays(ctx, 0);
+
+    ctx.total_switches = 0;
+    resizeSwitchArrays(ctx, 0);
+
+    ctx.current_tick = 0;
+    ctx.simulation_seed = 0;
+}
+
+void initializeSimulationState() {
+    initializeSimulationState(default_context);
+}
 
-        switch_is_global[i] = false;
+void resizeGrid(int rows, int cols) {
+    resizeGrid(default_context, rows, cols);
+}
 
-        for (int d = 0; d < 4; d++) {
-            switch_k_values[i][d] = 0;
-            switch_counters[i][d] = 0;
-        }
-    }
+void resizeTrainArrays(int count) {
+    resizeTrainArrays(default_context, count);
+}
 
-    current_tick = 0;
-    simulation_seed = 0;
-}
\ No newline at end of file
+void resizeSwitchArrays(int count) {
+    resizeSwitchArrays(default_context, count);
+}
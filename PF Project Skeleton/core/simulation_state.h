@@ -1,55 +1,245 @@
 #ifndef SIMULATION_STATE_H
 #define SIMULATION_STATE_H
 
-const int MAX_ROWS = 100;
-const int MAX_COLS = 100;
-const int MAX_TRAINS = 50;
-const int MAX_SWITCHES = 26;
+#include <vector>
+#include <string>
+#include <array>
+#include "profile.h"
+
+// ============================================================================
+// SIMULATION_STATE.H - Simulation state
+// ============================================================================
+// Everything one simulation needs lives in a SimulationContext. The core
+// functions take the context explicitly, so any number of simulations can
+// run side by side (one thread per context). The global names below refer
+// to the fields of default_context and the context-free function overloads
+// operate on it, so single-simulation code keeps working unchanged.
+//
+// All arrays are sized from the loaded level (see the resize functions at
+// the bottom). Flags are stored as char rather than vector<bool> so each
+// entry is a separate byte.
+// ============================================================================
 
 const int DIR_UP = 0;
 const int DIR_RIGHT = 1;
 const int DIR_DOWN = 2;
 const int DIR_LEFT = 3;
 
-extern char grid[MAX_ROWS][MAX_COLS];
-extern int grid_rows;
-extern int grid_cols;
+struct SimulationContext {
+    // grid[row][col], grid_rows strings of grid_cols characters
+    std::vector<std::string> grid;
+    int grid_rows;
+    int grid_cols;
+
+    // TRAINS
+    int train_count;
+    int total_trains;
+
+    std::vector<int> train_id;
+    std::vector<int> train_x;
+    std::vector<int> train_y;
+    std::vector<int> train_direction;
+    std::vector<int> train_color;
+    std::vector<int> train_spawn_tick;
+    std::vector<char> train_active;
+    std::vector<char> train_finished;
+    std::vector<int> train_arrival_tick;
+
+    std::vector<int> train_next_x;
+    std::vector<int> train_next_y;
+    std::vector<int> train_dest_x;
+    std::vector<int> train_dest_y;
+
+    // Spawn tile chosen for each train at load time (-1 if the map has no 'S')
+    std::vector<int> train_spawn_x;
+    std::vector<int> train_spawn_y;
+
+    std::vector<int> train_prev_x;
+    std::vector<int> train_prev_y;
+
+    // Per-train values from the TRAINS section
+    std::vector<int> train_wait;
+    std::vector<int> train_priority;
+
+    // SWITCHES
+    // Switch IDs are the names from the SWITCHES section (any token, e.g. "A"
+    // or "J12"); the index is the order in which they were declared.
+    int total_switches;
+    std::vector<std::string> switch_name;
+    std::vector<int> switch_x;
+    std::vector<int> switch_y;
+    std::vector<int> switch_state;
+    std::vector<char> switch_active;
+    std::vector<char> switch_is_global;
+
+    std::vector<std::array<int, 4> > switch_k_values;
+    std::vector<std::array<int, 4> > switch_counters;
+    std::vector<char> switch_flip_queued;
+
+    // Compiled grid: one TILE_* kind (tile_table.h) per tile, indexed by
+    // tileIndex(x, y). Built by compileTileKinds() after loading.
+    std::vector<unsigned char> tile_kind;
+
+    // Switch index on each tile, or -1. Built by buildSwitchMap().
+    std::vector<int> tile_switch;
+
+    // OCCUPANCY
+    // Number of active trains on each tile, indexed by tileIndex(x, y), and
+    // in total. Kept up to date by the spawn, move and arrival phases.
+    std::vector<int> tile_occupancy;
+    int active_trains;
+
+    // Collision scratch (trains.cpp): an entry is valid only while its stamp
+    // equals collision_pass, so the tables never need clearing.
+    std::vector<int> claim_stamp;
+    std::vector<int> claim_train;
+    std::vector<int> edge_stamp;
+    std::vector<int> edge_train;
+    int collision_pass;
+
+    // SPAWN QUEUE (trains.cpp)
+    // spawn_tiles lists every 'S' in row-major order. spawn_order holds train
+    // indices sorted by spawn tick; trains before spawn_cursor are due, and
+    // the due ones that have not spawned yet wait in spawn_pending.
+    // spawned_trains lists the trains that spawned this tick.
+    std::vector<int> spawn_tiles_x;
+    std::vector<int> spawn_tiles_y;
+    std::vector<int> spawn_order;
+    std::vector<int> spawn_pending;
+    std::vector<int> spawned_trains;
+    int spawn_cursor;
+
+    // PARALLEL PHASES (trains.cpp)
+    // Routing and movement are split across the worker pool (workers.h) once
+    // a level has at least parallel_min_trains trains. move_events holds one
+    // list per chunk (a single list when serial) of (train, old x, old y)
+    // triples for the occupancy merge and the state hash.
+    int parallel_min_trains;
+    std::vector<std::vector<int> > move_events;
+
+    // TRACK DISTANCES (track_distance.h)
+    // Slot of each track tile (-1 elsewhere), track_fields distance fields
+    // of track_slots * 4 entries each, and each train's field (-1: none).
+    std::vector<int> track_slot;
+    int track_slots;
+    int track_fields;
+    std::vector<unsigned short> track_distance;
+    std::vector<int> train_field;
 
-extern int train_count;
+    // STATE HASH (state_hash.cpp)
+    // Hash of each train and switch; trains_hash/switches_hash are the XOR
+    // of the entries. dirty_switches lists switches changed since the last
+    // updateStateHash() (repeats are harmless).
+    std::vector<unsigned long long> train_hash;
+    std::vector<unsigned long long> switch_hash;
+    unsigned long long trains_hash;
+    unsigned long long switches_hash;
+    std::vector<int> dirty_switches;
 
-extern int train_id[MAX_TRAINS];
-extern int train_x[MAX_TRAINS];
-extern int train_y[MAX_TRAINS];
-extern int train_direction[MAX_TRAINS];
-extern int train_color[MAX_TRAINS];
-extern int train_spawn_tick[MAX_TRAINS];
-extern bool train_active[MAX_TRAINS];
-extern bool train_finished[MAX_TRAINS];
-extern int train_arrival_tick[MAX_TRAINS];
+    // SIMULATION
+    int current_tick;
+    int simulation_seed;
+    unsigned int rng_state;
 
-extern int train_next_x[MAX_TRAINS];
-extern int train_next_y[MAX_TRAINS];
-extern int train_dest_x[MAX_TRAINS];
-extern int train_dest_y[MAX_TRAINS];
+    // OUTPUT (io.cpp)
+    std::string output_dir;
+    int trace_format;
+    int trace_stream;
+    int switch_stream;
+    int hash_stream;
 
-extern int total_trains;
+    // Binary trace block being filled, plus the block index
+    std::vector<int> bin_tick;
+    std::vector<int> bin_train;
+    std::vector<int> bin_x;
+    std::vector<int> bin_y;
+    std::vector<unsigned char> bin_dir;
+    std::vector<unsigned char> bin_state;
+    std::vector<unsigned char> bin_index;
+    unsigned long long bin_offset;
 
-extern int train_prev_x[MAX_TRAINS];
-extern int train_prev_y[MAX_TRAINS];
+#ifdef SR_PROFILE
+    // Phase timings and event counters (profile.h)
+    ProfileData profile;
+#endif
 
-extern int switch_x[MAX_SWITCHES];
-extern int switch_y[MAX_SWITCHES];
-extern int switch_state[MAX_SWITCHES];
-extern bool switch_active[MAX_SWITCHES];
-extern bool switch_is_global[MAX_SWITCHES];
+    SimulationContext();
+};
 
-extern int switch_k_values[MAX_SWITCHES][4];
-extern int switch_counters[MAX_SWITCHES][4];
-extern bool switch_flip_queued[MAX_SWITCHES];
+// The instance behind the global names and context-free functions
+extern SimulationContext default_context;
 
-extern int current_tick;
-extern int simulation_seed;
+extern std::vector<std::string> &grid;
+extern int &grid_rows;
+extern int &grid_cols;
 
+extern int &train_count;
+
+extern std::vector<int> &train_id;
+extern std::vector<int> &train_x;
+extern std::vector<int> &train_y;
+extern std::vector<int> &train_direction;
+extern std::vector<int> &train_color;
+extern std::vector<int> &train_spawn_tick;
+extern std::vector<char> &train_active;
+extern std::vector<char> &train_finished;
+extern std::vector<int> &train_arrival_tick;
+
+extern std::vector<int> &train_next_x;
+extern std::vector<int> &train_next_y;
+extern std::vector<int> &train_dest_x;
+extern std::vector<int> &train_dest_y;
+
+extern int &total_trains;
+
+extern std::vector<int> &train_spawn_x;
+extern std::vector<int> &train_spawn_y;
+
+extern std::vector<int> &train_prev_x;
+extern std::vector<int> &train_prev_y;
+
+extern std::vector<int> &train_wait;
+extern std::vector<int> &train_priority;
+
+extern int &total_switches;
+extern std::vector<std::string> &switch_name;
+extern std::vector<int> &switch_x;
+extern std::vector<int> &switch_y;
+extern std::vector<int> &switch_state;
+extern std::vector<char> &switch_active;
+extern std::vector<char> &switch_is_global;
+
+extern std::vector<std::array<int, 4> > &switch_k_values;
+extern std::vector<std::array<int, 4> > &switch_counters;
+extern std::vector<char> &switch_flip_queued;
+
+extern std::vector<int> &tile_occupancy;
+
+extern int &current_tick;
+extern int &simulation_seed;
+
+inline int tileIndex(const SimulationContext &ctx, int x, int y) {
+    return y * ctx.grid_cols + x;
+}
+
+inline int tileIndex(int x, int y) {
+    return tileIndex(default_context, x, y);
+}
+
+// Reset a context to an empty level.
+void initializeSimulationState(SimulationContext &ctx);
 void initializeSimulationState();
 
-#endif
\ No newline at end of file
+// Allocate the grid ('.' everywhere) and per-tile arrays for rows x cols.
+void resizeGrid(SimulationContext &ctx, int rows, int cols);
+void resizeGrid(int rows, int cols);
+
+// Grow or shrink the per-train arrays; new entries get their reset values.
+void resizeTrainArrays(SimulationContext &ctx, int count);
+void resizeTrainArrays(int count);
+
+// Grow or shrink the per-switch arrays; new entries get their reset values.
+void resizeSwitchArrays(SimulationContext &ctx, int count);
+void resizeSwitchArrays(int count);
+
+#endif
@@ -0,0 +1,226 @@
+#include "state_hash.h"
+#include "simulation.h"
+#include "level_cache.h"
+#include "workers.h"
+#include "log.h"
+#include <iostream>
+#include <cstdio>
+#include <climits>
+
+using namespace std;
+
+// ============================================================================
+// STATE_HASH.CPP - Incremental state hash and verifier
+// ============================================================================
+
+// splitmix64 finalizer
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t combine(uint64_t h, int64_t v) {
+    return mix64(h ^ ((uint64_t)v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+}
+
+static uint64_t trainHash(const SimulationContext &ctx, int i) {
+    uint64_t h = combine(0x7472616eULL, i);
+    h = combine(h, ctx.train_x[i]);
+    h = combine(h, ctx.train_y[i]);
+    h = combine(h, ctx.train_direction[i]);
+    h = combine(h, ctx.train_active[i]);
+    h = combine(h, ctx.train_finished[i]);
+    h = combine(h, ctx.train_arrival_tick[i]);
+    return h;
+}
+
+static uint64_t switchHash(const SimulationContext &ctx, int s) {
+    uint64_t h = combine(0x73776974ULL, s);
+    h = combine(h, ctx.switch_state[s]);
+    for (int d = 0; d < 4; d++) h = combine(h, ctx.switch_counters[s][d]);
+    h = combine(h, ctx.switch_flip_queued[s]);
+    return h;
+}
+
+static void rehashTrain(SimulationContext &ctx, int i) {
+    uint64_t h = trainHash(ctx, i);
+    ctx.trains_hash ^= ctx.train_hash[i] ^ h;
+    ctx.train_hash[i] = h;
+}
+
+static void rehashSwitch(SimulationContext &ctx, int s) {
+    uint64_t h = switchHash(ctx, s);
+    ctx.switches_hash ^= ctx.switch_hash[s] ^ h;
+    ctx.switch_hash[s] = h;
+}
+
+void resetStateHash(SimulationContext &ctx) {
+    ctx.train_hash.assign(ctx.total_trains, 0);
+    ctx.switch_hash.assign(ctx.total_switches, 0);
+    ctx.trains_hash = 0;
+    ctx.switches_hash = 0;
+    for (int i = 0; i < ctx.total_trains; i++) rehashTrain(ctx, i);
+    for (int s = 0; s < ctx.total_switches; s++) rehashSwitch(ctx, s);
+
+    ctx.spawned_trains.clear();
+    for (size_t c = 0; c < ctx.move_events.size(); c++) ctx.move_events[c].clear();
+    ctx.dirty_switches.clear();
+}
+
+void updateStateHash(SimulationContext &ctx) {
+    // A train changes only by spawning or moving (finishing on a 'D' counts
+    // as a move). A train that stays put keeps its direction, since every
+    // tile transition undoes itself, and checkArrivals() only finishes
+    // trains that spawned or moved this tick. Each list is used up here.
+    for (size_t k = 0; k < ctx.spawned_trains.size(); k++) rehashTrain(ctx, ctx.spawned_trains[k]);
+    ctx.spawned_trains.clear();
+    for (size_t c = 0; c < ctx.move_events.size(); c++) {
+        vector<int> &events = ctx.move_events[c];
+        for (size_t e = 0; e < events.size(); e += 3) rehashTrain(ctx, events[e]);
+        events.clear();
+    }
+
+    for (size_t k = 0; k < ctx.dirty_switches.size(); k++) rehashSwitch(ctx, ctx.dirty_switches[k]);
+    ctx.dirty_switches.clear();
+}
+
+uint64_t tickStateHash(const SimulationContext &ctx, int tick) {
+    uint64_t h = combine(ctx.trains_hash, (int64_t)ctx.switches_hash);
+    h = combine(h, tick);
+    return combine(h, ctx.rng_state);
+}
+
+// ----------------------------------------------------------------------------
+// VERIFIER
+// ----------------------------------------------------------------------------
+static bool loadForVerify(SimulationContext &ctx, const string &levelPath) {
+    initializeSimulationState(ctx);
+    if (!loadLevel(ctx, levelPath)) return false;
+    initializeSimulation(ctx);
+    return true;
+}
+
+static void printTrain(const SimulationContext &ctx, int i) {
+    cout << "pos=(" << ctx.train_x[i] << "," << ctx.train_y[i] << ") dir=" << ctx.train_direction[i]
+         << (ctx.train_active[i] ? " active" : "") << (ctx.train_finished[i] ? " finished" : "");
+}
+
+static void printSwitch(const SimulationContext &ctx, int s) {
+    cout << "state=" << ctx.switch_state[s] << " counters="
+         << ctx.switch_counters[s][0] << "," << ctx.switch_counters[s][1] << ","
+         << ctx.switch_counters[s][2] << "," << ctx.switch_counters[s][3]
+         << (ctx.switch_flip_queued[s] ? " flip queued" : "");
+}
+
+// Name the first train and switch whose hashes differ between two runs.
+static void reportDivergence(const SimulationContext &a, const SimulationContext &b) {
+    for (int i = 0; i < a.total_trains; i++) {
+        if (a.train_hash[i] == b.train_hash[i]) continue;
+        cout << "  train " << i << ": run 1 ";
+        printTrain(a, i);
+        cout << " | run 2 ";
+        printTrain(b, i);
+        cout << "\n";
+        break;
+    }
+    for (int s = 0; s < a.total_switches; s++) {
+        if (a.switch_hash[s] == b.switch_hash[s]) continue;
+        cout << "  switch " << a.switch_name[s] << ": run 1 ";
+        printSwitch(a, s);
+        cout << " | run 2 ";
+        printSwitch(b, s);
+        cout << "\n";
+        break;
+    }
+    if (a.rng_state != b.rng_state) cout << "  RNG state differs\n";
+}
+
+bool verifyDeterminism(const string &levelPath, int maxTicks) {
+    SimulationContext first, second;
+    if (!loadForVerify(first, levelPath) || !loadForVerify(second, levelPath)) return false;
+
+    // Run 1 is serial; run 2 uses the worker pool whenever one is running
+    first.parallel_min_trains = INT_MAX;
+    second.parallel_min_trains = 0;
+    cout << "Verifying " << levelPath << ": serial run vs run with "
+         << workerThreadCount() << " thread(s)\n";
+
+    bool same = true;
+    int ticks = 0;
+    while (maxTicks < 0 || ticks < maxTicks) {
+        simulateOneTick(first);
+        simulateOneTick(second);
+        ticks++;
+
+        if (tickStateHash(first, first.current_tick) != tickStateHash(second, second.current_tick)) {
+            cout << "DIVERGED at tick " << first.current_tick << "\n";
+            reportDivergence(first, second);
+            same = false;
+            break;
+        }
+        if (isSimulationComplete(first) && isSimulationComplete(second)) break;
+    }
+
+    if (same) cout << "OK: " << ticks << " ticks, identical state hashes\n";
+    return same;
+}
+
+bool verifyAgainstHashes(const string &levelPath, const string &hashesPath, int maxTicks) {
+    FILE *f = fopen(hashesPath.c_str(), "r");
+    if (!f) {
+        LOG_ERROR("Error: Cannot open " << hashesPath);
+        return false;
+    }
+
+    SimulationContext run;
+    if (!loadForVerify(run, levelPath)) {
+        fclose(f);
+        return false;
+    }
+
+    char line[160];
+    if (!fgets(line, sizeof(line), f)) line[0] = '\0';  // header
+
+    bool same = true;
+    int ticks = 0;
+    while (maxTicks < 0 || ticks < maxTicks) {
+        int tick;
+        unsigned long long hash, trains, switches;
+        if (!fgets(line, sizeof(line), f) ||
+            sscanf(line, "%d,%llx,%llx,%llx", &tick, &hash, &trains, &switches) != 4) {
+            if (!isSimulationComplete(run)) {
+                cout << "Stored hashes end at tick " << run.current_tick << ", run continues\n";
+                same = false;
+            }
+            break;
+        }
+
+        // Stored rows cover every tick, including fast-forwarded ones
+        simulateOneTick(run);
+        ticks++;
+
+        if (tick != run.current_tick || hash != tickStateHash(run, run.current_tick)) {
+            cout << "DIVERGED at tick " << run.current_tick << " (stored row is tick " << tick << ")";
+            if (trains != run.trains_hash) cout << ", trains differ";
+            if (switches != run.switches_hash) cout << ", switches differ";
+            cout << "\n";
+            same = false;
+            break;
+        }
+        if (isSimulationComplete(run)) {
+            if (fgets(line, sizeof(line), f)) {
+                cout << "Run completes at tick " << run.current_tick << " but stored hashes continue\n";
+                same = false;
+            }
+            break;
+        }
+    }
+    fclose(f);
+
+    if (same) cout << "OK: " << ticks << " ticks match " << hashesPath << "\n";
+    return same;
+}
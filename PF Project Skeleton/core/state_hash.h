@@ -0,0 +1,44 @@
+#ifndef STATE_HASH_H
+#define STATE_HASH_H
+
+#include <string>
+#include <stdint.h>
+#include "simulation_state.h"
+
+// ============================================================================
+// STATE_HASH.H - Per-tick state hash and determinism verifier
+// ============================================================================
+// Every train and switch has its own 64-bit hash (position, direction and
+// flags / state, counters and flip flag). The state hash is the XOR of them,
+// so a tick only rehashes the trains that spawned, moved or arrived (from
+// the spawn list and the move events) and the switches marked dirty when
+// they changed, and folds the differences in. tickStateHash() adds the tick and
+// the RNG state. simulateOneTick() keeps the hash current and the logs write
+// it to out/hashes.csv ("Tick,Hash,Trains,Switches", hex).
+// ============================================================================
+
+// Recompute every entity hash from scratch (after loading a level or a
+// checkpoint).
+void resetStateHash(SimulationContext &ctx);
+
+// Fold in the changes of the tick that just ran.
+void updateStateHash(SimulationContext &ctx);
+
+// Hash of the whole state, labelled with the given tick (normally
+// ctx.current_tick; idle ticks skipped by fast-forward pass their own).
+uint64_t tickStateHash(const SimulationContext &ctx, int tick);
+
+// Run the level twice side by side and compare the state hash after every
+// tick. With a worker pool running (setWorkerThreads), the second run uses
+// the parallel phases for any train count, so this also checks that they
+// match the serial engine. Reports the first divergent tick and the train
+// or switch that differs. maxTicks < 0 runs to completion. Returns true if
+// the runs agree.
+bool verifyDeterminism(const std::string &levelPath, int maxTicks);
+
+// Run the level once and compare against a hashes.csv written by an earlier
+// run. Reports the first tick whose hash differs (and whether trains or
+// switches differ). Returns true if every tick matches.
+bool verifyAgainstHashes(const std::string &levelPath, const std::string &hashesPath, int maxTicks);
+
+#endif
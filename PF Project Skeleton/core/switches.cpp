@@ -1,46 +1,55 @@
 #include "switches.h"
 #include "simulation_state.h"
-#include <iostream>
+#include "log.h"
 
 using namespace std;
 
-int total_switches=0; 
+// Build tile_switch from switch_x/switch_y. When several switches share a
+// tile the first declared one wins.
+void buildSwitchMap(SimulationContext &ctx) {
+    ctx.tile_switch.assign((size_t)ctx.grid_rows * ctx.grid_cols, -1);
+    for (int i = ctx.total_switches - 1; i >= 0; --i) {
+        int x = ctx.switch_x[i];
+        int y = ctx.switch_y[i];
+        if (x < 0 || x >= ctx.grid_cols || y < 0 || y >= ctx.grid_rows) continue;
+        ctx.tile_switch[tileIndex(ctx, x, y)] = i;
+    }
+}
+
 // Check if a tile is a switch
-bool isSwitchTile(int x, int y) {
-    if (x < 0 || x >= grid_cols || y < 0 || y >= grid_rows) return false;
-    char tile = grid[y][x];
-    return (tile == 'A' || tile == 'B');
+bool isSwitchTile(const SimulationContext &ctx, int x, int y) {
+    return getSwitchIndex(ctx, x, y) != -1;
 }
 
 // Get the switch index at position (x, y), return -1 if not a switch
-int getSwitchIndex(int x, int y) {
-    for (int i = 0; i < total_switches; ++i) {
-        if (switch_x[i] == x && switch_y[i] == y) {
-            return i;
-        }
-    }
-    return -1;
+int getSwitchIndex(const SimulationContext &ctx, int x, int y) {
+    if (x < 0 || x >= ctx.grid_cols || y < 0 || y >= ctx.grid_rows) return -1;
+    return ctx.tile_switch[tileIndex(ctx, x, y)];
 }
 
-// Toggle a switch between state A and B
-void toggleSwitch(int switchIndex) {
-    if (switchIndex < 0 || switchIndex >= total_switches) return;
-    
-    // Toggle: 'A' <-> 'B'
-    if (switch_state[switchIndex] == 'A') {
-        switch_state[switchIndex] = 'B';
-    } else {
-        switch_state[switchIndex] = 'A';
-    }
-    
-    cout << "Switch " << switchIndex << " toggled to state " << switch_state[switchIndex] << endl;
+// Toggle a switch between STRAIGHT (0) and TURN (1)
+void toggleSwitch(SimulationContext &ctx, int switchIndex) {
+    if (switchIndex < 0 || switchIndex >= ctx.total_switches) return;
+
+    ctx.switch_state[switchIndex] = (ctx.switch_state[switchIndex] == 1) ? 0 : 1;
+    ctx.dirty_switches.push_back(switchIndex);
+
+    LOG_DEBUG("Switch " << switchIndex << " toggled to state " << ctx.switch_state[switchIndex]);
 }
 
 // Initialize switches (called once at simulation start)
-void initializeSwitches() {
-    for (int i = 0; i < total_switches; ++i) {
-        // Switches start in state 'A' by default
-        switch_state[i] = 'A';
+void initializeSwitches(SimulationContext &ctx) {
+    for (int i = 0; i < ctx.total_switches; ++i) {
+        // Switches start STRAIGHT by default
+        ctx.switch_state[i] = 0;
+        ctx.dirty_switches.push_back(i);
     }
-    cout << "Switches initialized: " << total_switches << " total\n";
-}
\ No newline at end of file
+    LOG_INFO("Switches initialized: " << ctx.total_switches << " total");
+}
+
+// Default-context wrappers
+void buildSwitchMap() { buildSwitchMap(default_context); }
+bool isSwitchTile(int x, int y) { return isSwitchTile(default_context, x, y); }
+int getSwitchIndex(int x, int y) { return getSwitchIndex(default_context, x, y); }
+void toggleSwitch(int switchIndex) { toggleSwitch(default_context, switchIndex); }
+void initializeSwitches() { initializeSwitches(default_context); }
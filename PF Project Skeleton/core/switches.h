@@ -1,17 +1,27 @@
 #ifndef SWITCHES_H
 #define SWITCHES_H
 
-extern int total_switches; 
-// Check if a tile at (x,y) is a switch
+#include "simulation_state.h"
+
+// Index the switches by tile (ctx.tile_switch). Called after loading;
+// call again if switch_x/switch_y change.
+void buildSwitchMap(SimulationContext &ctx);
+void buildSwitchMap();
+
+// Check if a declared switch sits on tile (x,y)
+bool isSwitchTile(const SimulationContext &ctx, int x, int y);
 bool isSwitchTile(int x, int y);
 
-// Get the switch index at (x,y), or -1 if none
+// Get the switch index at (x,y), or -1 if none. O(1) via tile_switch.
+int getSwitchIndex(const SimulationContext &ctx, int x, int y);
 int getSwitchIndex(int x, int y);
 
-// Toggle a switch between states A and B
+// Toggle a switch between STRAIGHT (0) and TURN (1)
+void toggleSwitch(SimulationContext &ctx, int switchIndex);
 void toggleSwitch(int switchIndex);
 
 // Initialize all switches to default state
+void initializeSwitches(SimulationContext &ctx);
 void initializeSwitches();
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,58 @@
+#ifndef TILE_TABLE_H
+#define TILE_TABLE_H
+
+// ============================================================================
+// TILE_TABLE.H - Compiled tile kinds and direction transitions
+// ============================================================================
+// The loader compiles every grid character into a tile kind (stored in
+// SimulationContext::tile_kind). Routing and movement then look up
+//
+//     TILE_TRANSITIONS[kind][turn][incoming dir] -> outgoing dir, dx, dy
+//
+// instead of branching on the character. `turn` is 1 only on a switch tile
+// whose switch is in the TURN state. Directions use DIR_UP/RIGHT/DOWN/LEFT.
+// ============================================================================
+
+const int TILE_STRAIGHT = 0;         // track, junctions, empty: keep direction
+const int TILE_CURVE_SLASH = 1;      // '/'
+const int TILE_CURVE_BACKSLASH = 2;  // '\'
+const int TILE_SWITCH = 3;           // any other tile with a declared switch
+const int TILE_DEST = 4;             // 'D' (keeps direction)
+const int TILE_KIND_COUNT = 5;
+
+struct TileTransition {
+    signed char dir;
+    signed char dx;
+    signed char dy;
+};
+
+#define TT_UP    { 0,  0, -1 }
+#define TT_RIGHT { 1,  1,  0 }
+#define TT_DOWN  { 2,  0,  1 }
+#define TT_LEFT  { 3, -1,  0 }
+
+// Indexed by incoming direction: UP, RIGHT, DOWN, LEFT
+constexpr TileTransition TILE_TRANSITIONS[TILE_KIND_COUNT][2][4] = {
+    // TILE_STRAIGHT
+    { { TT_UP, TT_RIGHT, TT_DOWN, TT_LEFT }, { TT_UP, TT_RIGHT, TT_DOWN, TT_LEFT } },
+    // TILE_CURVE_SLASH: right->up, down->left, left->down, up->right
+    { { TT_RIGHT, TT_UP, TT_LEFT, TT_DOWN }, { TT_RIGHT, TT_UP, TT_LEFT, TT_DOWN } },
+    // TILE_CURVE_BACKSLASH: right->down, up->left, left->up, down->right
+    { { TT_LEFT, TT_DOWN, TT_RIGHT, TT_UP }, { TT_LEFT, TT_DOWN, TT_RIGHT, TT_UP } },
+    // TILE_SWITCH: straight, or turn right<->down, left<->up
+    { { TT_UP, TT_RIGHT, TT_DOWN, TT_LEFT }, { TT_LEFT, TT_DOWN, TT_RIGHT, TT_UP } },
+    // TILE_DEST
+    { { TT_UP, TT_RIGHT, TT_DOWN, TT_LEFT }, { TT_UP, TT_RIGHT, TT_DOWN, TT_LEFT } },
+};
+
+#undef TT_UP
+#undef TT_RIGHT
+#undef TT_DOWN
+#undef TT_LEFT
+
+// moveAllTrains() steps with the older direction numbering
+// (0 = east, 1 = south, 2 = west, 3 = north); kept so results do not change.
+constexpr signed char MOVE_STEP_DX[4] = { 1, 0, -1, 0 };
+constexpr signed char MOVE_STEP_DY[4] = { 0, 1, 0, -1 };
+
+#endif
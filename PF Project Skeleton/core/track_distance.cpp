@@ -0,0 +1,158 @@
+#include "track_distance.h"
+#include "grid.h"
+#include "trains.h"
+#include "tile_table.h"
+#include "workers.h"
+#include "log.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+// ============================================================================
+// TRACK_DISTANCE.CPP - Distance fields over (track tile, direction) states
+// ============================================================================
+
+static bool inGrid(const SimulationContext &ctx, int x, int y) {
+    return x >= 0 && x < ctx.grid_cols && y >= 0 && y < ctx.grid_rows;
+}
+
+// True if a train entering a tile of this kind heading `in` can leave it
+// heading `out` (a switch tile either way).
+static bool canTurn(int kind, int in, int out) {
+    if (TILE_TRANSITIONS[kind][0][in].dir == out) return true;
+    return kind == TILE_SWITCH && TILE_TRANSITIONS[kind][1][in].dir == out;
+}
+
+static void addSource(const SimulationContext &ctx, int tile, unsigned short *field, vector<int> &queue) {
+    int slot = ctx.track_slot[tile];
+    for (int dir = 0; dir < 4; dir++) {
+        if (field[slot * 4 + dir] == 0) continue;
+        field[slot * 4 + dir] = 0;
+        queue.push_back(tile * 4 + dir);
+    }
+}
+
+// Fill one field by a reverse BFS from every 'D' tile plus `dest` (-1 for
+// none). The queue holds tile * 4 + direction, with grid tile indices so
+// neighbours are found directly.
+//
+// One tick takes (p, in) to (tile, dir): moveTrain turns `in` into `step`
+// by p's transition and moves by MOVE_STEP[step], then the next routing
+// turns `step` into `dir` by the new tile's transition. Steps onto tiles
+// that are not track are not followed.
+static void buildField(const SimulationContext &ctx, const vector<int> &destTiles, int dest, unsigned short *field,
+                       vector<int> &queue) {
+    fill(field, field + (size_t)ctx.track_slots * 4, TRACK_DISTANCE_UNREACHABLE);
+    queue.clear();
+    for (size_t k = 0; k < destTiles.size(); k++) addSource(ctx, destTiles[k], field, queue);
+    if (dest != -1) addSource(ctx, dest, field, queue);
+
+    for (size_t head = 0; head < queue.size(); head++) {
+        int tile = queue[head] >> 2;
+        int dir = queue[head] & 3;
+        int x = tile % ctx.grid_cols;
+        int y = tile / ctx.grid_cols;
+        int kind = ctx.tile_kind[tile];
+
+        // Very long paths saturate just below UNREACHABLE
+        unsigned short dist = field[ctx.track_slot[tile] * 4 + dir];
+        unsigned short next = (dist < TRACK_DISTANCE_UNREACHABLE - 1) ? dist + 1 : dist;
+
+        for (int step = 0; step < 4; step++) {
+            if (!canTurn(kind, step, dir)) continue;
+            int px = x - MOVE_STEP_DX[step];
+            int py = y - MOVE_STEP_DY[step];
+            if (!inGrid(ctx, px, py)) continue;
+
+            int p = tileIndex(ctx, px, py);
+            int slot = ctx.track_slot[p];
+            if (slot < 0) continue;
+            for (int in = 0; in < 4; in++) {
+                if (field[slot * 4 + in] != TRACK_DISTANCE_UNREACHABLE || !canTurn(ctx.tile_kind[p], in, step))
+                    continue;
+                field[slot * 4 + in] = next;
+                queue.push_back(p * 4 + in);
+            }
+        }
+    }
+}
+
+void buildTrackDistances(SimulationContext &ctx) {
+    ctx.track_slot.assign((size_t)ctx.grid_rows * ctx.grid_cols, -1);
+    ctx.track_slots = 0;
+    vector<int> destTiles;
+    for (int y = 0; y < ctx.grid_rows; y++) {
+        for (int x = 0; x < ctx.grid_cols; x++) {
+            if (!isTrackTile(ctx, x, y)) continue;
+            int tile = tileIndex(ctx, x, y);
+            ctx.track_slot[tile] = ctx.track_slots++;
+            if (ctx.tile_kind[tile] == TILE_DEST) destTiles.push_back(tile);
+        }
+    }
+
+    // One field per distinct destination. Destinations that are a 'D' or
+    // off the track add nothing to the 'D' sources, so they share one field
+    // (key -1).
+    map<int, int> fieldOf;
+    vector<int> fieldDest;
+    ctx.train_field.assign(ctx.total_trains, -1);
+    for (int i = 0; i < ctx.total_trains; i++) {
+        int dx = ctx.train_dest_x[i];
+        int dy = ctx.train_dest_y[i];
+        int tile = -1;
+        if (inGrid(ctx, dx, dy)) tile = tileIndex(ctx, dx, dy);
+        if (tile != -1 && (ctx.track_slot[tile] < 0 || ctx.tile_kind[tile] == TILE_DEST)) tile = -1;
+        if (tile == -1 && destTiles.empty()) continue;
+
+        map<int, int>::iterator it = fieldOf.find(tile);
+        if (it == fieldOf.end()) {
+            it = fieldOf.insert(make_pair(tile, (int)fieldDest.size())).first;
+            fieldDest.push_back(tile);
+        }
+        ctx.train_field[i] = it->second;
+    }
+
+    size_t states = (size_t)ctx.track_slots * 4;
+    size_t entries = fieldDest.size() * states;
+    if (entries > TRACK_DISTANCE_MAX_ENTRIES) {
+        LOG_WARN("Warning: " << fieldDest.size() << " destinations over " << ctx.track_slots
+                 << " track tiles exceed the distance field limit; collisions use Manhattan distance");
+        fieldDest.clear();
+        ctx.train_field.assign(ctx.total_trains, -1);
+        entries = 0;
+    }
+
+    ctx.track_fields = (int)fieldDest.size();
+    ctx.track_distance.assign(entries, TRACK_DISTANCE_UNREACHABLE);
+    if (ctx.track_fields == 0) return;
+
+    // Fields are independent: one chunk each
+    parallelFor(ctx.track_fields, ctx.track_fields, [&ctx, &destTiles, &fieldDest, states](int, int begin, int end) {
+        vector<int> queue;
+        for (int f = begin; f < end; f++)
+            buildField(ctx, destTiles, fieldDest[f], &ctx.track_distance[f * states], queue);
+    });
+    LOG_DEBUG("Track distances: " << ctx.track_fields << " fields over " << ctx.track_slots << " track tiles");
+}
+
+int remainingTrackDistance(const SimulationContext &ctx, int i) {
+    int x = ctx.train_x[i];
+    int y = ctx.train_y[i];
+    int dir = ctx.train_direction[i];
+    int f = (i < (int)ctx.train_field.size()) ? ctx.train_field[i] : -1;
+
+    if (f >= 0 && inGrid(ctx, x, y) && dir >= 0 && dir < 4) {
+        int slot = ctx.track_slot[tileIndex(ctx, x, y)];
+        if (slot >= 0) return ctx.track_distance[((size_t)f * ctx.track_slots + slot) * 4 + dir];
+    }
+    return getManhattanDistance(x, y, ctx.train_dest_x[i], ctx.train_dest_y[i]);
+}
+
+// ----------------------------------------------------------------------------
+// DEFAULT-CONTEXT WRAPPERS
+// ----------------------------------------------------------------------------
+
+void buildTrackDistances() { buildTrackDistances(default_context); }
+int remainingTrackDistance(int i) { return remainingTrackDistance(default_context, i); }
@@ -0,0 +1,49 @@
+#ifndef TRACK_DISTANCE_H
+#define TRACK_DISTANCE_H
+
+#include "simulation_state.h"
+
+// ============================================================================
+// TRACK_DISTANCE.H - Remaining track distance to each train destination
+// ============================================================================
+// A train's state is its tile plus the direction routing left in
+// train_direction, which is what collision detection sees. The fields
+// follow the engine's movement rather than the drawn track: moveAllTrains
+// applies the tile's transition once more and steps with MOVE_STEP_DX/DY
+// (0 = east), and the next tick's routing turns by the new tile. A reverse
+// BFS over these states from the tiles where a run ends gives the number of
+// moves still to go. A switch tile has an edge for both of its states,
+// since the switch may be set either way when the train gets there, so the
+// distance is the shortest movement allows.
+//
+// A train finishes on its destination or on any 'D' tile (moveAllTrains),
+// so a field is seeded from every 'D' plus one destination. Trains whose
+// destination is a 'D' or off the track all share the 'D'-only field; only
+// other track destinations need fields of their own.
+//
+// The fields are built at load time and stored compactly: track tiles get a
+// slot (ctx.track_slot), a field holds one 16-bit distance per (slot,
+// direction), and each train records its field (ctx.train_field). Trains
+// off the track, and levels whose fields would exceed
+// TRACK_DISTANCE_MAX_ENTRIES, fall back to the Manhattan distance.
+// ============================================================================
+
+// Distance stored for states that cannot reach the destination
+const unsigned short TRACK_DISTANCE_UNREACHABLE = 0xFFFF;
+
+// Largest number of stored distances (2 bytes each) before falling back
+const size_t TRACK_DISTANCE_MAX_ENTRIES = (size_t)1 << 26;
+
+// Build the slots and the fields the trains need. Call after
+// the tile kinds and the switch map are built. Runs the fields on the
+// worker pool when one is running.
+void buildTrackDistances(SimulationContext &ctx);
+void buildTrackDistances();
+
+// Moves from train i's current state to the end of its run (0 on a 'D'
+// or its destination).
+// Unreachable states return a value larger than any reachable one.
+int remainingTrackDistance(const SimulationContext &ctx, int i);
+int remainingTrackDistance(int i);
+
+#endif
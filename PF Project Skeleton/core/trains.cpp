@@ -2,9 +2,16 @@
 #include "simulation_state.h"
 #include "grid.h"
 #include "switches.h"
+#include "workers.h"
+#include "tile_table.h"
+#include "profile.h"
+#include "track_distance.h"
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <vector>
+#include <map>
+#include <algorithm>
 
 using namespace std;
 
@@ -12,219 +19,451 @@ int getManhattanDistance(int x1, int y1, int x2, int y2) {
     return abs(x1 - x2) + abs(y1 - y2);
 }
 
-void spawnTrainsForTick() {
-    for (int i = 0; i < total_trains; i++) {
-
-        if (!train_active[i] && !train_finished[i] &&
-            train_spawn_tick[i] <= current_tick) {
-
-            // Find 'S' tile closest to this train's destination
-            int sx = -1, sy = -1;
-            int minDist = 99999;
-            
-            for (int r = 0; r < grid_rows; r++) {
-                for (int c = 0; c < grid_cols; c++) {
-                    if (grid[r][c] == 'S') {
-                        int dist = abs(r - train_dest_y[i]) + abs(c - train_dest_x[i]);
-                        if (dist < minDist) {
-                            minDist = dist;
-                            sx = c;
-                            sy = r;
-                        }
-                    }
-                }
-            }
-            
-            if (sx == -1) continue; // No 'S' found
-
-            // Check if spawn location is blocked
-            bool blocked = false;
-            for(int j = 0; j < total_trains; j++) {
-                if (train_active[j] &&
-                    train_x[j] == sx && train_y[j] == sy) {
-                    blocked = true;
-                    break;
-                }
-            }
+// ----------------------------------------------------------------------------
+// OCCUPANCY INDEX
+// ----------------------------------------------------------------------------
+// tile_occupancy counts active trains per tile. The claim and edge tables
+// are scratch space for detectCollisions(); an entry is only valid when its
+// stamp matches the current collision pass, so they never need clearing.
+// ----------------------------------------------------------------------------
+static bool inGrid(const SimulationContext &ctx, int x, int y) {
+    return x >= 0 && x < ctx.grid_cols && y >= 0 && y < ctx.grid_rows;
+}
 
-            if (!blocked) {
-                train_x[i] = sx;
-                train_y[i] = sy;
-                train_direction[i] = 0; // Start East (will be corrected by getNextDirection)
-                train_active[i] = true;
-            }
-        }
-    }
+static void occupyTile(SimulationContext &ctx, int x, int y) {
+    if (inGrid(ctx, x, y)) ctx.tile_occupancy[tileIndex(ctx, x, y)]++;
 }
 
+static void vacateTile(SimulationContext &ctx, int x, int y) {
+    if (inGrid(ctx, x, y)) ctx.tile_occupancy[tileIndex(ctx, x, y)]--;
+}
+
+void rebuildOccupancyIndex(SimulationContext &ctx) {
+    size_t tiles = (size_t)ctx.grid_rows * ctx.grid_cols;
+    ctx.tile_occupancy.assign(tiles, 0);
 
+    ctx.claim_stamp.assign(tiles, 0);
+    ctx.claim_train.assign(tiles, -1);
+    ctx.edge_stamp.assign(tiles * 4, 0);
+    ctx.edge_train.assign(tiles * 4, -1);
+    ctx.collision_pass = 0;
 
+    ctx.active_trains = 0;
+    for (int i = 0; i < ctx.total_trains; i++) {
+        if (!ctx.train_active[i]) continue;
+        occupyTile(ctx, ctx.train_x[i], ctx.train_y[i]);
+        ctx.active_trains++;
+    }
+}
 
+bool isTileOccupied(const SimulationContext &ctx, int x, int y) {
+    return inGrid(ctx, x, y) && ctx.tile_occupancy[tileIndex(ctx, x, y)] > 0;
+}
 
-int getNextDirection(int trainIdx) {
-    int cx = train_x[trainIdx];
-    int cy = train_y[trainIdx];
-    int cdir = train_direction[trainIdx];
-    
-    // Check bounds
-    if (cy < 0 || cy >= grid_rows || cx < 0 || cx >= grid_cols) {
-        return cdir; // Keep current direction if out of bounds
+// ----------------------------------------------------------------------------
+// SPAWN INDEX
+// ----------------------------------------------------------------------------
+// 'S' tile closest (Manhattan) to (dx, dy); first in row-major order on ties.
+static int closestSpawnTile(const SimulationContext &ctx, int dx, int dy) {
+    int best = -1;
+    int minDist = 0;
+    for (int k = 0; k < (int)ctx.spawn_tiles_x.size(); k++) {
+        int dist = abs(ctx.spawn_tiles_y[k] - dy) + abs(ctx.spawn_tiles_x[k] - dx);
+        if (best == -1 || dist < minDist) {
+            minDist = dist;
+            best = k;
+        }
     }
-    
-    char t = grid[cy][cx];
-    
-    // Handle switches FIRST (they override track behavior)
-    if (isSwitchTile(cx, cy)) {
-        int swIdx = getSwitchIndex(cx, cy);
-        if (swIdx != -1) {
-            if (switch_state[swIdx] == 1) { // TURN state
-                if(cdir == DIR_RIGHT) return DIR_DOWN;
-                if(cdir == DIR_DOWN) return DIR_RIGHT; 
-                if(cdir == DIR_LEFT) return DIR_UP;
-                if(cdir == DIR_UP) return DIR_LEFT;
+    return best;
+}
+
+void buildSpawnIndex(SimulationContext &ctx) {
+    ctx.spawn_tiles_x.clear();
+    ctx.spawn_tiles_y.clear();
+    for (int r = 0; r < ctx.grid_rows; r++) {
+        for (int c = 0; c < ctx.grid_cols; c++) {
+            if (ctx.grid[r][c] == 'S') {
+                ctx.spawn_tiles_x.push_back(c);
+                ctx.spawn_tiles_y.push_back(r);
             }
-            // If switch is STRAIGHT (state 0), fall through to normal track handling
         }
     }
-    
-    // Handle curved tracks
-    if (t == '/') {
-        if (cdir == DIR_RIGHT) return DIR_UP;
-        if (cdir == DIR_DOWN) return DIR_LEFT;
-        if (cdir == DIR_LEFT) return DIR_DOWN;
-        if (cdir == DIR_UP) return DIR_RIGHT;
-    }
-    else if (t == '\\') {
-        if (cdir == DIR_RIGHT) return DIR_DOWN;
-        if (cdir == DIR_UP) return DIR_LEFT;
-        if (cdir == DIR_LEFT) return DIR_UP;
-        if (cdir == DIR_DOWN) return DIR_RIGHT;
-    }
-    // Handle straight tracks - they maintain direction
-    else if (t == '=' || t == '-' || t == '|' || t == '+' || 
-             t == 'S' || t == 'D' || t == 'A' || t == 'B' || 
-             t == 'C' || t == 'E' || t == 'F' || t == 'G' ||
-             t == 'H' || t == 'I' || t == 'J' || t == 'K' || t == 'L') {
-        // Straight track or junction - keep moving in current direction
-        return cdir;
-    }
-    
-    // Default: keep current direction
-    return cdir;
-}
-
-void determineAllRoutes() {
-    for (int i = 0; i < total_trains; i++) {
-        if (!train_active[i]) continue;
-        
-        train_direction[i] = getNextDirection(i);
-
-        int dx = 0, dy = 0;
-        if (train_direction[i] == DIR_UP) dy = -1;
-        else if (train_direction[i] == DIR_DOWN) dy = 1;
-        else if (train_direction[i] == DIR_LEFT) dx = -1;
-        else if (train_direction[i] == DIR_RIGHT) dx = 1;
-        
-        train_next_x[i] = train_x[i] + dx;
-        train_next_y[i] = train_y[i] + dy;
-    }
-}
-
-void detectCollisions() {
-    for (int i = 0; i < total_trains; i++) {
-        if (!train_active[i]) continue;
-
-        for (int j = i + 1; j < total_trains; j++) {
-            if (!train_active[j]) continue;
-
-            if (train_next_x[i] == train_next_x[j] && train_next_y[i] == train_next_y[j]) {
-                
-                int distI = getManhattanDistance(train_x[i], train_y[i], train_dest_x[i], train_dest_y[i]);
-                int distJ = getManhattanDistance(train_x[j], train_y[j], train_dest_x[j], train_dest_y[j]);
-
-                if (distI > distJ) {
-                    train_next_x[j] = train_x[j];
-                    train_next_y[j] = train_y[j];
-                } else {
-                    train_next_x[i] = train_x[i];
-                    train_next_y[i] = train_y[i];
-                }
-            }
-            else if (train_next_x[i] == train_x[j] && train_next_y[i] == train_y[j] &&
-                     train_next_x[j] == train_x[i] && train_next_y[j] == train_y[i]) {
-                
-                int distI = getManhattanDistance(train_x[i], train_y[i], train_dest_x[i], train_dest_y[i]);
-                int distJ = getManhattanDistance(train_x[j], train_y[j], train_dest_x[j], train_dest_y[j]);
-
-                if (distI > distJ) {
-                    train_next_x[j] = train_x[j];
-                    train_next_y[j] = train_y[j];
-                } else {
-                    train_next_x[i] = train_x[i];
-                    train_next_y[i] = train_y[i];
-                }
-            }
+
+    // Trains sharing a destination share a spawn tile
+    map<pair<int, int>, int> chosen;
+    for (int i = 0; i < ctx.total_trains; i++) {
+        pair<int, int> dest(ctx.train_dest_x[i], ctx.train_dest_y[i]);
+        map<pair<int, int>, int>::iterator it = chosen.find(dest);
+        int k;
+        if (it == chosen.end()) {
+            k = closestSpawnTile(ctx, dest.first, dest.second);
+            chosen[dest] = k;
+        } else {
+            k = it->second;
         }
+        ctx.train_spawn_x[i] = (k == -1) ? -1 : ctx.spawn_tiles_x[k];
+        ctx.train_spawn_y[i] = (k == -1) ? -1 : ctx.spawn_tiles_y[k];
+    }
+
+    rebuildSpawnQueue(ctx);
+}
+
+void rebuildSpawnQueue(SimulationContext &ctx) {
+    const vector<int> &spawnTick = ctx.train_spawn_tick;
+
+    ctx.spawn_order.clear();
+    for (int i = 0; i < ctx.total_trains; i++) ctx.spawn_order.push_back(i);
+    sort(ctx.spawn_order.begin(), ctx.spawn_order.end(), [&spawnTick](int a, int b) {
+        if (spawnTick[a] != spawnTick[b]) return spawnTick[a] < spawnTick[b];
+        return a < b;
+    });
+
+    ctx.spawn_cursor = 0;
+    ctx.spawn_pending.clear();
+    while (ctx.spawn_cursor < (int)ctx.spawn_order.size() &&
+           spawnTick[ctx.spawn_order[ctx.spawn_cursor]] <= ctx.current_tick) {
+        int i = ctx.spawn_order[ctx.spawn_cursor++];
+        if (!ctx.train_active[i] && !ctx.train_finished[i]) ctx.spawn_pending.push_back(i);
     }
+    sort(ctx.spawn_pending.begin(), ctx.spawn_pending.end());
 }
 
-void moveAllTrains() {
-    for (int i = 0; i < total_trains; i++) {
-        if (!train_active[i]) continue;
-        
-        // CHECK IF ALREADY AT DESTINATION BEFORE MOVING
-        char currentTile = grid[train_y[i]][train_x[i]];
-        if (currentTile == 'D') {  // ✅ Just check for 'D'!
-            train_finished[i] = true;
-            train_active[i] = false;
-            train_arrival_tick[i] = current_tick;
+void spawnTrainsForTick(SimulationContext &ctx) {
+    vector<int> &pending = ctx.spawn_pending;
+
+    // Trains whose spawn tick has come join the pending list
+    while (ctx.spawn_cursor < (int)ctx.spawn_order.size() &&
+           ctx.train_spawn_tick[ctx.spawn_order[ctx.spawn_cursor]] <= ctx.current_tick) {
+        int i = ctx.spawn_order[ctx.spawn_cursor++];
+        if (ctx.train_active[i] || ctx.train_finished[i]) continue;
+        pending.insert(upper_bound(pending.begin(), pending.end(), i), i);
+    }
+
+    ctx.spawned_trains.clear();
+    int kept = 0;
+    for (int p = 0; p < (int)pending.size(); p++) {
+        int i = pending[p];
+        int sx = ctx.train_spawn_x[i];
+        int sy = ctx.train_spawn_y[i];
+
+        // No 'S' on the map, or spawn location blocked by an active train
+        if (sx == -1 || isTileOccupied(ctx, sx, sy)) {
+            pending[kept++] = i;
+            PROFILE_COUNT(ctx, PROFILE_SPAWNS_BLOCKED, 1);
             continue;
         }
-        
-        // UPDATE DIRECTION based on current tile
-        train_direction[i] = getNextDirection(i);
-        
-        // THEN calculate next position
-        int nextX = train_x[i];
-        int nextY = train_y[i];
-        
-        if (train_direction[i] == 0) nextX++; // East
-        else if (train_direction[i] == 1) nextY++; // South
-        else if (train_direction[i] == 2) nextX--; // West
-        else if (train_direction[i] == 3) nextY--; // North
-        
-        // Bounds check
-        if (nextX < 0 || nextX >= grid_cols || nextY < 0 || nextY >= grid_rows) {
-            continue;
+
+        ctx.train_x[i] = sx;
+        ctx.train_y[i] = sy;
+        ctx.train_direction[i] = 0; // Start East (will be corrected by getNextDirection)
+        ctx.train_active[i] = true;
+        ctx.active_trains++;
+        occupyTile(ctx, sx, sy);
+        ctx.spawned_trains.push_back(i);
+        PROFILE_COUNT(ctx, PROFILE_SPAWNED, 1);
+    }
+    pending.resize(kept);
+}
+
+// ----------------------------------------------------------------------------
+// TILE KINDS
+// ----------------------------------------------------------------------------
+static unsigned char compileTileKind(const SimulationContext &ctx, int x, int y) {
+    char t = ctx.grid[y][x];
+    if (t == '/') return TILE_CURVE_SLASH;
+    if (t == '\\') return TILE_CURVE_BACKSLASH;
+    if (t == 'D') return TILE_DEST;
+    if (isSwitchTile(ctx, x, y)) return TILE_SWITCH;
+    return TILE_STRAIGHT;
+}
+
+void compileTileKinds(SimulationContext &ctx) {
+    ctx.tile_kind.assign((size_t)ctx.grid_rows * ctx.grid_cols, TILE_STRAIGHT);
+    for (int y = 0; y < ctx.grid_rows; y++)
+        for (int x = 0; x < ctx.grid_cols; x++)
+            ctx.tile_kind[tileIndex(ctx, x, y)] = compileTileKind(ctx, x, y);
+}
+
+void updateTileKind(SimulationContext &ctx, int x, int y) {
+    if (inGrid(ctx, x, y)) ctx.tile_kind[tileIndex(ctx, x, y)] = compileTileKind(ctx, x, y);
+}
+
+// Transition for a train on tile (x, y) heading cdir; see hasTransition().
+static const TileTransition &tileTransition(const SimulationContext &ctx, int x, int y, int cdir) {
+    int t = tileIndex(ctx, x, y);
+    int kind = ctx.tile_kind[t];
+    int turn = 0;
+    if (kind == TILE_SWITCH) turn = (ctx.switch_state[ctx.tile_switch[t]] == 1) ? 1 : 0;
+    return TILE_TRANSITIONS[kind][turn][cdir];
+}
+
+// True when (x, y) is on the grid and cdir is one of the four directions.
+static bool hasTransition(const SimulationContext &ctx, int x, int y, int cdir) {
+    return inGrid(ctx, x, y) && cdir >= 0 && cdir < 4;
+}
+
+int getNextDirection(const SimulationContext &ctx, int trainIdx) {
+    int cx = ctx.train_x[trainIdx];
+    int cy = ctx.train_y[trainIdx];
+    int cdir = ctx.train_direction[trainIdx];
+
+    // Keep current direction if out of bounds
+    if (!hasTransition(ctx, cx, cy, cdir)) return cdir;
+    return tileTransition(ctx, cx, cy, cdir).dir;
+}
+
+// ----------------------------------------------------------------------------
+// PARALLEL PHASES
+// ----------------------------------------------------------------------------
+// Routing and movement only write the state of the train being processed, so
+// train ranges can run on different threads. The one shared structure,
+// tile_occupancy, is updated afterwards from per-chunk event lists; the
+// counts end up the same whatever the chunking, so results are identical to
+// the serial loop for any thread count. Collision detection stays serial:
+// its claim tables are resolved in train order.
+// ----------------------------------------------------------------------------
+static const int CHUNKS_PER_THREAD = 4;
+
+static bool useWorkers(const SimulationContext &ctx) {
+    return workerThreadCount() > 1 && ctx.total_trains >= ctx.parallel_min_trains;
+}
+
+static int chunkCount() {
+    return workerThreadCount() * CHUNKS_PER_THREAD;
+}
+
+static void routeTrain(SimulationContext &ctx, int i) {
+    int x = ctx.train_x[i];
+    int y = ctx.train_y[i];
+    int cdir = ctx.train_direction[i];
+    ctx.train_next_x[i] = x;
+    ctx.train_next_y[i] = y;
+    if (!hasTransition(ctx, x, y, cdir)) return;
+
+    const TileTransition &t = tileTransition(ctx, x, y, cdir);
+    ctx.train_direction[i] = t.dir;
+    ctx.train_next_x[i] = x + t.dx;
+    ctx.train_next_y[i] = y + t.dy;
+}
+
+void determineAllRoutes(SimulationContext &ctx) {
+    if (!useWorkers(ctx)) {
+        for (int i = 0; i < ctx.total_trains; i++)
+            if (ctx.train_active[i]) routeTrain(ctx, i);
+        return;
+    }
+
+    parallelFor(ctx.total_trains, chunkCount(), [&ctx](int, int begin, int end) {
+        for (int i = begin; i < end; i++)
+            if (ctx.train_active[i]) routeTrain(ctx, i);
+    });
+}
+
+// Hold a train on its current tile for this tick.
+static void holdTrain(SimulationContext &ctx, int i) {
+    ctx.train_next_x[i] = ctx.train_x[i];
+    ctx.train_next_y[i] = ctx.train_y[i];
+}
+
+// Priority: the train with more track left to its destination moves first.
+// Returns the loser of a conflict between trains a < b (ties hold a).
+static int conflictLoser(const SimulationContext &ctx, int a, int b) {
+    int distA = remainingTrackDistance(ctx, a);
+    int distB = remainingTrackDistance(ctx, b);
+    return (distA > distB) ? b : a;
+}
+
+// Direction index of a one-tile step, or -1 if (dx, dy) is not a step.
+static int stepIndex(int dx, int dy) {
+    if (dx == 0 && dy == -1) return 0;
+    if (dx == 1 && dy == 0) return 1;
+    if (dx == 0 && dy == 1) return 2;
+    if (dx == -1 && dy == 0) return 3;
+    return -1;
+}
+
+// Register train i's claim on its next tile; a train that loses a claim is
+// held and falls back to claiming its own tile.
+static void claimNextTile(SimulationContext &ctx, int i) {
+    while (inGrid(ctx, ctx.train_next_x[i], ctx.train_next_y[i])) {
+        int t = tileIndex(ctx, ctx.train_next_x[i], ctx.train_next_y[i]);
+        if (ctx.claim_stamp[t] != ctx.collision_pass) {
+            ctx.claim_stamp[t] = ctx.collision_pass;
+            ctx.claim_train[t] = i;
+            return;
         }
-        
-        // Update position
-        train_x[i] = nextX;
-        train_y[i] = nextY;
-        
-        // Check if JUST ARRIVED at destination
-        char nextTile = grid[nextY][nextX];
-        if (nextTile == 'D') {  // ✅ Just check for 'D'!
-            train_finished[i] = true;
-            train_active[i] = false;
-            train_arrival_tick[i] = current_tick;
+
+        int other = ctx.claim_train[t];
+        int a = (other < i) ? other : i;
+        int b = (other < i) ? i : other;
+        int loser = conflictLoser(ctx, a, b);
+        int winner = (loser == a) ? b : a;
+        ctx.claim_train[t] = winner;
+        PROFILE_COUNT(ctx, PROFILE_CONFLICTS, 1);
+
+        if (ctx.train_next_x[loser] == ctx.train_x[loser] && ctx.train_next_y[loser] == ctx.train_y[loser])
+            return; // already holding, nothing more to give up
+        holdTrain(ctx, loser);
+        i = loser;
+    }
+}
+
+void detectCollisions(SimulationContext &ctx) {
+    ctx.collision_pass++;
+
+    // Same-tile conflicts
+    for (int i = 0; i < ctx.total_trains; i++) {
+        if (!ctx.train_active[i]) continue;
+        claimNextTile(ctx, i);
+    }
+
+    // Head-on swaps: train i moving a->b while a train on b moves b->a
+    for (int i = 0; i < ctx.total_trains; i++) {
+        if (!ctx.train_active[i]) continue;
+        if (!inGrid(ctx, ctx.train_x[i], ctx.train_y[i])) continue;
+
+        int step = stepIndex(ctx.train_next_x[i] - ctx.train_x[i], ctx.train_next_y[i] - ctx.train_y[i]);
+        if (step < 0 || !inGrid(ctx, ctx.train_next_x[i], ctx.train_next_y[i])) continue;
+
+        int reverse = tileIndex(ctx, ctx.train_next_x[i], ctx.train_next_y[i]) * 4 + (step + 2) % 4;
+        if (ctx.edge_stamp[reverse] == ctx.collision_pass) {
+            int j = ctx.edge_train[reverse];
+            if (ctx.train_next_x[j] == ctx.train_x[i] && ctx.train_next_y[j] == ctx.train_y[i] &&
+                ctx.train_next_x[i] == ctx.train_x[j] && ctx.train_next_y[i] == ctx.train_y[j]) {
+                int loser = conflictLoser(ctx, j, i);
+                holdTrain(ctx, loser);
+                PROFILE_COUNT(ctx, PROFILE_CONFLICTS, 1);
+                if (loser == i) continue;
+            }
         }
+
+        int edge = tileIndex(ctx, ctx.train_x[i], ctx.train_y[i]) * 4 + step;
+        ctx.edge_stamp[edge] = ctx.collision_pass;
+        ctx.edge_train[edge] = i;
     }
 }
 
+// Advance one active train. Returns true if it left its tile (moved or
+// finished); the caller then updates tile_occupancy.
+static bool moveTrain(SimulationContext &ctx, int i) {
+    // CHECK IF ALREADY AT DESTINATION BEFORE MOVING
+    if (ctx.tile_kind[tileIndex(ctx, ctx.train_x[i], ctx.train_y[i])] == TILE_DEST) {
+        ctx.train_finished[i] = true;
+        ctx.train_active[i] = false;
+        ctx.train_arrival_tick[i] = ctx.current_tick;
+        return true;
+    }
+
+    // UPDATE DIRECTION based on current tile, THEN calculate next position
+    int dir = getNextDirection(ctx, i);
+    ctx.train_direction[i] = dir;
+
+    int nextX = ctx.train_x[i];
+    int nextY = ctx.train_y[i];
+    if (dir >= 0 && dir < 4) {
+        nextX += MOVE_STEP_DX[dir];
+        nextY += MOVE_STEP_DY[dir];
+    }
+
+    // Bounds check
+    if (!inGrid(ctx, nextX, nextY)) return false;
 
+    // Update position
+    ctx.train_x[i] = nextX;
+    ctx.train_y[i] = nextY;
 
+    // Check if JUST ARRIVED at destination
+    if (ctx.tile_kind[tileIndex(ctx, nextX, nextY)] == TILE_DEST) {
+        ctx.train_finished[i] = true;
+        ctx.train_active[i] = false;
+        ctx.train_arrival_tick[i] = ctx.current_tick;
+    }
+    return true;
+}
 
+// Move a train's occupancy entry from (oldX, oldY) to its current tile, or
+// drop it if the train finished.
+static void updateOccupancy(SimulationContext &ctx, int i, int oldX, int oldY) {
+    vacateTile(ctx, oldX, oldY);
+    PROFILE_COUNT(ctx, PROFILE_TRAINS_MOVED, 1);
+    if (ctx.train_active[i]) {
+        occupyTile(ctx, ctx.train_x[i], ctx.train_y[i]);
+    } else {
+        ctx.active_trains--;
+        PROFILE_COUNT(ctx, PROFILE_ARRIVED, 1);
+    }
+}
+
+void moveAllTrains(SimulationContext &ctx) {
+    if (!useWorkers(ctx)) {
+        ctx.move_events.resize(1);
+        vector<int> &events = ctx.move_events[0];
+        events.clear();
+        for (int i = 0; i < ctx.total_trains; i++) {
+            if (!ctx.train_active[i]) continue;
+            int oldX = ctx.train_x[i];
+            int oldY = ctx.train_y[i];
+            if (!moveTrain(ctx, i)) continue;
+            updateOccupancy(ctx, i, oldX, oldY);
+            events.push_back(i);
+            events.push_back(oldX);
+            events.push_back(oldY);
+        }
+        return;
+    }
+
+    int chunks = chunkCount();
+    ctx.move_events.resize(chunks);
+    parallelFor(ctx.total_trains, chunks, [&ctx](int chunk, int begin, int end) {
+        vector<int> &events = ctx.move_events[chunk];
+        events.clear();
+        for (int i = begin; i < end; i++) {
+            if (!ctx.train_active[i]) continue;
+            int oldX = ctx.train_x[i];
+            int oldY = ctx.train_y[i];
+            if (moveTrain(ctx, i)) {
+                events.push_back(i);
+                events.push_back(oldX);
+                events.push_back(oldY);
+            }
+        }
+    });
+
+    // Merge in chunk order
+    for (int c = 0; c < chunks; c++) {
+        const vector<int> &events = ctx.move_events[c];
+        for (size_t e = 0; e < events.size(); e += 3)
+            updateOccupancy(ctx, events[e], events[e + 1], events[e + 2]);
+    }
+}
 
-void checkArrivals() {
-    for (int i = 0; i < total_trains; i++) {
-        if (!train_active[i] || train_finished[i]) continue;
+void checkArrivals(SimulationContext &ctx) {
+    for (int i = 0; i < ctx.total_trains; i++) {
+        if (!ctx.train_active[i] || ctx.train_finished[i]) continue;
 
-        if (train_x[i] == train_dest_x[i] && train_y[i] == train_dest_y[i]) {
-            train_finished[i] = true;
-            train_active[i] = false;
-            train_arrival_tick[i] = current_tick;
+        if (ctx.train_x[i] == ctx.train_dest_x[i] && ctx.train_y[i] == ctx.train_dest_y[i]) {
+            ctx.train_finished[i] = true;
+            ctx.train_active[i] = false;
+            ctx.train_arrival_tick[i] = ctx.current_tick;
+            vacateTile(ctx, ctx.train_x[i], ctx.train_y[i]);
+            ctx.active_trains--;
+            PROFILE_COUNT(ctx, PROFILE_ARRIVED, 1);
         }
     }
 }
 
+// ----------------------------------------------------------------------------
+// DEFAULT-CONTEXT WRAPPERS
+// ----------------------------------------------------------------------------
+void rebuildOccupancyIndex() { rebuildOccupancyIndex(default_context); }
+void compileTileKinds() { compileTileKinds(default_context); }
+void updateTileKind(int x, int y) { updateTileKind(default_context, x, y); }
+bool isTileOccupied(int x, int y) { return isTileOccupied(default_context, x, y); }
+void buildSpawnIndex() { buildSpawnIndex(default_context); }
+void rebuildSpawnQueue() { rebuildSpawnQueue(default_context); }
+void spawnTrainsForTick() { spawnTrainsForTick(default_context); }
+int getNextDirection(int trainIdx) { return getNextDirection(default_context, trainIdx); }
+void determineAllRoutes() { determineAllRoutes(default_context); }
+void detectCollisions() { detectCollisions(default_context); }
+void moveAllTrains() { moveAllTrains(default_context); }
+void checkArrivals() { checkArrivals(default_context); }
@@ -1,21 +1,63 @@
 #ifndef TRAINS_H
 #define TRAINS_H
 
+#include "simulation_state.h"
+
 extern int getManhattanDistance(int x1, int y1, int x2, int y2);
 // ============================================================================
 // TRAINS.H - Train logic
 // ============================================================================
+// Each function takes the SimulationContext it works on; the overloads
+// without one operate on default_context.
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+// OCCUPANCY INDEX
+// ----------------------------------------------------------------------------
+// Recount tile_occupancy from the active trains (after loading a level).
+void rebuildOccupancyIndex(SimulationContext &ctx);
+void rebuildOccupancyIndex();
+
+// True if any active train stands on (x, y).
+bool isTileOccupied(const SimulationContext &ctx, int x, int y);
+bool isTileOccupied(int x, int y);
+
+// ----------------------------------------------------------------------------
+// TILE KINDS
+// ----------------------------------------------------------------------------
+// Compile the grid into ctx.tile_kind (see tile_table.h). Called after
+// loading a level, once the switches are placed.
+void compileTileKinds(SimulationContext &ctx);
+void compileTileKinds();
+
+// Recompile one tile after its character was edited.
+void updateTileKind(SimulationContext &ctx, int x, int y);
+void updateTileKind(int x, int y);
 
 // ----------------------------------------------------------------------------
 // TRAIN SPAWNING
 // ----------------------------------------------------------------------------
-// Spawn trains scheduled for the current tick.
+// Collect the 'S' tiles, pick each train's spawn tile (the 'S' closest to its
+// destination) and rebuild the spawn queue. Called after loading a level;
+// call again after any map edit that adds or removes 'S' tiles.
+void buildSpawnIndex(SimulationContext &ctx);
+void buildSpawnIndex();
+
+// Rebuild the spawn queue from train state (spawn ticks, active/finished).
+void rebuildSpawnQueue(SimulationContext &ctx);
+void rebuildSpawnQueue();
+
+// Spawn trains scheduled for the current tick. Only trains that are due
+// (spawn tick reached, not yet spawned) are visited.
+void spawnTrainsForTick(SimulationContext &ctx);
 void spawnTrainsForTick();
 
 // ----------------------------------------------------------------------------
 // TRAIN ROUTING
 // ----------------------------------------------------------------------------
-// Compute routes for all active trains (Phase 2).
+// Compute routes for all active trains (Phase 2). Runs on the worker pool
+// for levels with at least ctx.parallel_min_trains trains.
+void determineAllRoutes(SimulationContext &ctx);
 void determineAllRoutes();
 
 // Helper: Compute next position/direction for a specific train.
@@ -23,6 +65,7 @@ void determineAllRoutes();
 bool determineNextPosition(int trainIdx);
 
 // Helper: Get next direction when entering a tile (curves, switches).
+int getNextDirection(const SimulationContext &ctx, int trainIdx);
 int getNextDirection(int trainIdx);
 
 // Helper: Choose best direction at a crossing '+' to get closer to D.
@@ -31,19 +74,24 @@ int getSmartDirectionAtCrossing(int trainIdx);
 // ----------------------------------------------------------------------------
 // TRAIN MOVEMENT
 // ----------------------------------------------------------------------------
-// Move trains and handle collisions (Phase 5).
+// Move trains and handle collisions (Phase 5). Parallel like routing; the
+// occupancy updates are merged afterwards in train order.
+void moveAllTrains(SimulationContext &ctx);
 void moveAllTrains();
 
 // ----------------------------------------------------------------------------
 // COLLISION DETECTION
 // ----------------------------------------------------------------------------
 // Detect trains targeting the same tile/swap/crossing and apply Priority.
+// Uses per-tile claims and directed-edge keys: O(active trains) per tick.
+void detectCollisions(SimulationContext &ctx);
 void detectCollisions();
 
 // ----------------------------------------------------------------------------
 // ARRIVALS
 // ----------------------------------------------------------------------------
 // Mark trains that reached destinations.
+void checkArrivals(SimulationContext &ctx);
 void checkArrivals();
 
 // ----------------------------------------------------------------------------
@@ -55,4 +103,4 @@ void applyEmergencyHalt();
 // Update emergency halt timer.
 void updateEmergencyHalt();
 
-#endif
\ No newline at end of file
+#endif
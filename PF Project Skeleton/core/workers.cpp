@@ -0,0 +1,134 @@
+#include "workers.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdlib>
+#include <stdint.h>
+
+using namespace std;
+
+// ============================================================================
+// WORKERS.CPP - Worker pool
+// ============================================================================
+
+static vector<thread> workers;
+static mutex poolMutex;            // guards job, runners and poolStop
+static mutex callMutex;            // one parallelFor() at a time
+static condition_variable jobStart;
+static condition_variable jobFinish;
+
+// The current job. Workers copy it under poolMutex and never read the
+// shared one while running.
+struct Job {
+    const function<void(int, int, int)> *fn;
+    int count;
+    int chunks;
+    uint32_t generation;
+};
+static Job job = { NULL, 0, 0, 0 };
+
+// The job's generation in the high 32 bits and the next chunk in the low
+// 32, so a thread still holding an older job can never claim a chunk of
+// the current one.
+static atomic<uint64_t> nextChunk(0);
+
+static int runners = 0;            // threads inside runChunks()
+static bool poolStop = false;
+static bool exitHookInstalled = false;
+
+// Claim and run chunks of `j` until none are left.
+static void runChunks(const Job &j) {
+    uint64_t claim = nextChunk.load();
+    while ((uint32_t)(claim >> 32) == j.generation && (int)(uint32_t)claim < j.chunks) {
+        if (!nextChunk.compare_exchange_weak(claim, claim + 1)) continue;
+        int c = (int)(uint32_t)claim;
+        int begin = (int)((long long)j.count * c / j.chunks);
+        int end = (int)((long long)j.count * (c + 1) / j.chunks);
+        (*j.fn)(c, begin, end);
+        claim = nextChunk.load();
+    }
+}
+
+static void workerLoop() {
+    unique_lock<mutex> lock(poolMutex);
+    uint32_t seen = job.generation;
+    while (true) {
+        jobStart.wait(lock, [&seen] { return poolStop || job.generation != seen; });
+        if (poolStop) break;
+        Job mine = job;
+        seen = mine.generation;
+        runners++;
+
+        lock.unlock();
+        runChunks(mine);
+        lock.lock();
+        if (--runners == 0) jobFinish.notify_all();
+    }
+}
+
+static void stopAtExit() {
+    setWorkerThreads(1);
+}
+
+void setWorkerThreads(int threads) {
+    lock_guard<mutex> call(callMutex);
+
+    {
+        lock_guard<mutex> lock(poolMutex);
+        poolStop = true;
+    }
+    jobStart.notify_all();
+    for (int i = 0; i < (int)workers.size(); i++) workers[i].join();
+    workers.clear();
+    poolStop = false;
+
+    for (int i = 1; i < threads; i++) workers.push_back(thread(workerLoop));
+    if (!workers.empty() && !exitHookInstalled) {
+        atexit(stopAtExit);
+        exitHookInstalled = true;
+    }
+}
+
+int workerThreadCount() {
+    return (int)workers.size() + 1;
+}
+
+void parallelFor(int count, int chunks, const function<void(int, int, int)> &fn) {
+    if (count <= 0) return;
+    if (chunks < 1) chunks = 1;
+
+    lock_guard<mutex> call(callMutex);
+
+    if (workers.empty() || chunks == 1) {
+        for (int c = 0; c < chunks; c++) {
+            int begin = (int)((long long)count * c / chunks);
+            int end = (int)((long long)count * (c + 1) / chunks);
+            fn(c, begin, end);
+        }
+        return;
+    }
+
+    Job mine;
+    {
+        lock_guard<mutex> lock(poolMutex);
+        job.fn = &fn;
+        job.count = count;
+        job.chunks = chunks;
+        job.generation++;
+        nextChunk.store((uint64_t)job.generation << 32);
+        mine = job;
+        runners++;
+    }
+    jobStart.notify_all();
+
+    runChunks(mine);
+
+    // Every chunk is claimed once this thread runs out; waiting for all
+    // runners to leave means every claimed chunk has finished too.
+    unique_lock<mutex> lock(poolMutex);
+    runners--;
+    jobFinish.wait(lock, [] { return runners == 0; });
+    job.fn = NULL;
+}
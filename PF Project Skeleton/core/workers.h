@@ -0,0 +1,26 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <functional>
+
+// ============================================================================
+// WORKERS.H - Shared worker pool for the parallel tick phases
+// ============================================================================
+// parallelFor() splits [0, count) into `chunks` contiguous ranges and runs
+// them on the pool (the calling thread takes part). Which thread runs which
+// chunk is not fixed, so callers must only write data owned by the chunk and
+// merge anything shared afterwards, in chunk order.
+// ============================================================================
+
+// Resize the pool to `threads` workers in total (including the caller).
+// 0 or 1 stops the pool; parallelFor() then runs everything inline.
+void setWorkerThreads(int threads);
+
+// Current pool size (1 when no pool is running).
+int workerThreadCount();
+
+// Run fn(chunk, begin, end) for every chunk and wait for all of them.
+// Calls from different threads are serialized.
+void parallelFor(int count, int chunks, const std::function<void(int, int, int)> &fn);
+
+#endif
@@ -1,7 +1,13 @@
 #include "app.h"
+#include "renderer.h"
+#include "sim_thread.h"
 #include "../core/simulation_state.h"
+#include "../core/log.h"
 #include <SFML/Graphics.hpp>
 #include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
@@ -10,36 +16,51 @@ using namespace std;
 sf::RenderWindow window;
 sf::Font font;
 
-// Textures for different track types
-sf::Texture trackStraightTexture;
-sf::Texture trackCurveTexture;
-sf::Texture trackCrossTexture;
-sf::Texture switchATexture;
-sf::Texture switchBTexture;
-sf::Texture sourceTexture;
-sf::Texture destTexture;
-
-// Train textures (4 directions)
-sf::Texture trainTextures[4];
-
 // Camera/view
 sf::View camera;
 float cameraX = 0.f, cameraY = 0.f;
 float zoomLevel = 1.0f;
 
-// Tile rendering size
-const float TILE_SIZE = 64.f;
+// Camera speed (screen pixels per second) and zoom step per wheel notch
+const float PAN_SPEED = 600.f;
+const float ZOOM_STEP = 1.25f;
+
+// Middle-button drag state (last mouse position, in pixels)
+bool isDragging = false;
+int dragX = 0, dragY = 0;
+
+// Simulation speed: multiples of the base rate of one tick per
+// TICK_INTERVAL. 0 is uncapped (as many ticks per frame as the frame
+// budget allows).
+const float TICK_INTERVAL = 0.5f;
+const float SPEED_MULTIPLIERS[] = {0.25f, 0.5f, 1.f, 2.f, 4.f, 8.f, 16.f, 64.f, 256.f, 0.f};
+const int SPEED_LEVELS = sizeof(SPEED_MULTIPLIERS) / sizeof(SPEED_MULTIPLIERS[0]);
+const int NORMAL_SPEED = 2;
+int speedLevel = NORMAL_SPEED;
+
+// Weight of the newest frame in the frame-time average, and how often the
+// achieved tick rate is re-measured (seconds)
+const float FRAME_TIME_WEIGHT = 0.1f;
+const float RATE_WINDOW = 0.5f;
+
+static void setSpeedLevel(int level) {
+    speedLevel = max(0, min(SPEED_LEVELS - 1, level));
+    float multiplier = SPEED_MULTIPLIERS[speedLevel];
+    setSimTickInterval(multiplier > 0.f ? TICK_INTERVAL / multiplier : 0.0);
+}
 
-// Pause state
-bool isPaused = false;
+static string speedLabel() {
+    float multiplier = SPEED_MULTIPLIERS[speedLevel];
+    if (multiplier == 0.f) return "MAX";
+    ostringstream label;
+    label << multiplier << "x";
+    return label.str();
+}
 
-// Helper to load a texture
-static bool loadTex(sf::Texture &tex, const string &path) {
-    if (!tex.loadFromFile(path)) {
-        cerr << "Warning: failed to load texture: " << path << "\n";
-        return false;
-    }
-    return true;
+// Zoom by a factor (>1 zooms out), keeping the camera center.
+static void zoomCamera(float factor) {
+    zoomLevel *= factor;
+    camera.zoom(factor);
 }
 
 bool initializeApp() {
@@ -49,38 +70,38 @@ bool initializeApp() {
 
     // Load font (optional)
     if (!font.loadFromFile("assets/fonts/Arial.ttf")) {
-        cerr << "Warning: could not load font. Text may not display.\n";
+        LOG_WARN("Warning: could not load font. Text may not display.");
     }
 
-    // Load track textures
-    loadTex(trackStraightTexture, "Sprites/track_straight.png");
-    loadTex(trackCurveTexture, "Sprites/track_curve.png");
-    loadTex(trackCrossTexture, "Sprites/track_cross.png");
-    loadTex(switchATexture, "Sprites/switch_A.png");
-    loadTex(switchBTexture, "Sprites/switch_B.png");
-    loadTex(sourceTexture, "Sprites/source.png");
-    loadTex(destTexture, "Sprites/destination.png");
-
-    // Load train textures (4 directions: UP=0, DOWN=1, LEFT=2, RIGHT=3)
-    loadTex(trainTextures[0], "Sprites/train_up.png");
-    loadTex(trainTextures[1], "Sprites/train_down.png");
-    loadTex(trainTextures[2], "Sprites/train_left.png");
-    loadTex(trainTextures[3], "Sprites/train_right.png");
+    // Pack the sprites into the atlas and build the track layer
+    if (!initializeRenderer()) return false;
+    buildStaticLayer(default_context);
 
     // Initialize camera centered on grid
-    float gridPixelWidth = grid_cols * TILE_SIZE * 0.5f;
-    float gridPixelHeight = grid_rows * TILE_SIZE * 0.5f;
+    float gridPixelWidth = grid_cols * TILE_PIXELS;
+    float gridPixelHeight = grid_rows * TILE_PIXELS;
+    cameraX = gridPixelWidth / 2.f;
+    cameraY = gridPixelHeight / 2.f;
     camera = window.getDefaultView();
-    camera.setCenter(gridPixelWidth / 2.f, gridPixelHeight / 2.f);
+    camera.setCenter(cameraX, cameraY);
     window.setView(camera);
 
     return true;
 }
 
 void runApp() {
-    sf::Clock clock;
-    float timeAccumulator = 0.f;
-    const float TICK_INTERVAL = 0.5f; // 0.5 seconds per tick
+    sf::Clock frameClock;
+    float frameTime = 1.f / 60;
+
+    // Achieved ticks/sec, measured over RATE_WINDOW
+    sf::Clock rateClock;
+    int rateStartTick = current_tick;
+    float achievedRate = 0.f;
+
+    // The simulation ticks on its own thread from here on; this loop only
+    // reads the snapshots it publishes
+    startSimThread(TICK_INTERVAL, false);
+    setSpeedLevel(speedLevel);
 
     while (window.isOpen()) {
         sf::Event event;
@@ -88,125 +109,100 @@ void runApp() {
             if (event.type == sf::Event::Closed) {
                 window.close();
             }
+            if (event.type == sf::Event::Resized) {
+                camera.setSize(event.size.width * zoomLevel, event.size.height * zoomLevel);
+            }
+            if (event.type == sf::Event::MouseWheelScrolled) {
+                zoomCamera(event.mouseWheelScroll.delta > 0 ? 1.f / ZOOM_STEP : ZOOM_STEP);
+            }
+            if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Middle) {
+                isDragging = true;
+                dragX = event.mouseButton.x;
+                dragY = event.mouseButton.y;
+            }
+            if (event.type == sf::Event::MouseButtonReleased && event.mouseButton.button == sf::Mouse::Middle) {
+                isDragging = false;
+            }
+            if (event.type == sf::Event::MouseMoved && isDragging) {
+                cameraX -= (event.mouseMove.x - dragX) * zoomLevel;
+                cameraY -= (event.mouseMove.y - dragY) * zoomLevel;
+                dragX = event.mouseMove.x;
+                dragY = event.mouseMove.y;
+            }
             if (event.type == sf::Event::KeyPressed) {
                 if (event.key.code == sf::Keyboard::Escape) {
                     window.close();
                 }
                 if (event.key.code == sf::Keyboard::Space) {
-                    isPaused = !isPaused;
-                    cout << (isPaused ? "PAUSED" : "RESUMED") << "\n";
+                    setSimPaused(!isSimPaused());
+                    LOG_INFO((isSimPaused() ? "PAUSED" : "RESUMED"));
                 }
                 // Manual step with '.' key
                 if (event.key.code == sf::Keyboard::Period) {
-                    simulateOneTick();
-                    logTrainTrace();
-                    logSwitchState();
-                    cout << "Manual step: tick " << current_tick << "\n";
+                    requestSimStep();
                 }
-            }
-        }
-
-        // Auto-tick if not paused
-        if (!isPaused) {
-            float dt = clock.restart().asSeconds();
-            timeAccumulator += dt;
-            if (timeAccumulator >= TICK_INTERVAL) {
-                timeAccumulator = 0.f;
-                simulateOneTick();
-                logTrainTrace();
-                logSwitchState();
-
-                if (isSimulationComplete()) {
-                    cout << "\n*** SIMULATION COMPLETE at tick " << current_tick << " ***\n";
-                    isPaused = true;
+                // Speed: ']' faster, '[' slower, 0 uncapped, 1 normal
+                if (event.key.code == sf::Keyboard::RBracket) setSpeedLevel(speedLevel + 1);
+                if (event.key.code == sf::Keyboard::LBracket) setSpeedLevel(speedLevel - 1);
+                if (event.key.code == sf::Keyboard::Num0) setSpeedLevel(SPEED_LEVELS - 1);
+                if (event.key.code == sf::Keyboard::Num1) setSpeedLevel(NORMAL_SPEED);
+                if (event.key.code == sf::Keyboard::Add || event.key.code == sf::Keyboard::Equal) {
+                    zoomCamera(1.f / ZOOM_STEP);
+                }
+                if (event.key.code == sf::Keyboard::Subtract || event.key.code == sf::Keyboard::Hyphen) {
+                    zoomCamera(ZOOM_STEP);
                 }
             }
-        } else {
-            clock.restart();
         }
 
-        // Clear window
-        window.clear(sf::Color(30, 30, 30));
+        // The simulation may spend about one frame on ticks between two
+        // snapshots; the frame time is measured, not assumed
+        float frameDt = frameClock.restart().asSeconds();
+        frameTime += FRAME_TIME_WEIGHT * (min(frameDt, 0.25f) - frameTime);
+        setSimFrameBudget(frameTime);
+
+        // Pan with the arrow keys, at the same screen speed at any zoom
+        float step = PAN_SPEED * zoomLevel * frameDt;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) cameraX -= step;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) cameraX += step;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up)) cameraY -= step;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down)) cameraY += step;
+        camera.setCenter(cameraX, cameraY);
+        window.setView(camera);
 
-        // Draw grid tiles
-        sf::Sprite tileSprite;
-        for (int row = 0; row < grid_rows; ++row) {
-            for (int col = 0; col < grid_cols; ++col) {
-                char tile = grid[row][col];
-                float x = col * TILE_SIZE * 0.5f;  // Adjust for scale
-                float y = row * TILE_SIZE * 0.5f;  // Adjust for scale
-
-                // Choose texture based on tile type
-                if (tile == '-' || tile == '|') {
-                    tileSprite.setTexture(trackStraightTexture);
-                    tileSprite.setRotation(0.f);
-                    tileSprite.setPosition(x, y);
-                    if (tile == '|') {
-                        tileSprite.setRotation(90.f);
-                    }
-                } else if (tile == '+') {
-                    tileSprite.setTexture(trackCrossTexture);
-                    tileSprite.setRotation(0.f);
-                    tileSprite.setPosition(x, y);
-                } else if (tile == '/') {
-                    tileSprite.setTexture(trackCurveTexture);
-                    tileSprite.setRotation(0.f);
-                    tileSprite.setPosition(x, y);
-                } else if (tile == '\\') {
-                    tileSprite.setTexture(trackCurveTexture);
-                    tileSprite.setRotation(90.f);
-                    tileSprite.setPosition(x, y);
-                } else if (tile == 'A') {
-                    tileSprite.setTexture(switchATexture);
-                    tileSprite.setRotation(0.f);
-                    tileSprite.setPosition(x, y);
-                } else if (tile == 'B') {
-                    tileSprite.setTexture(switchBTexture);
-                    tileSprite.setRotation(0.f);
-                    tileSprite.setPosition(x, y);
-                } else if (tile == 'S') {
-                    tileSprite.setTexture(sourceTexture);
-                    tileSprite.setRotation(0.f);
-                    tileSprite.setPosition(x, y);
-                } else if (tile == 'D') {
-                    tileSprite.setTexture(destTexture);
-                    tileSprite.setRotation(0.f);
-                    tileSprite.setPosition(x, y);
-                } else {
-                    continue;
-                }
+        // Take the newest tick, if the simulation thread published one
+        pollSnapshot();
+        const TickSnapshot &snapshot = currentSnapshot();
 
-                tileSprite.setScale(0.5f, 0.5f);
-                window.draw(tileSprite);
-            }
+        float rateElapsed = rateClock.getElapsedTime().asSeconds();
+        if (rateElapsed >= RATE_WINDOW) {
+            achievedRate = (snapshot.tick - rateStartTick) / rateElapsed;
+            rateStartTick = snapshot.tick;
+            rateClock.restart();
         }
 
-        // Draw trains
-        sf::Sprite trainSprite;
-        for (int i = 0; i < MAX_TRAINS; ++i) {
-            if (!train_active[i]) continue;
-
-            int tx = train_x[i];
-            int ty = train_y[i];
-            int dir = train_direction[i];
-
-            float screenX = tx * TILE_SIZE * 0.5f;  // Adjust for scale
-            float screenY = ty * TILE_SIZE * 0.5f;  // Adjust for scale
+        // Clear window
+        window.clear(sf::Color(30, 30, 30));
 
-            trainSprite.setTexture(trainTextures[dir]);
-            trainSprite.setPosition(screenX, screenY);
-            trainSprite.setScale(0.4f, 0.4f);
-            window.draw(trainSprite);
-        }
+        // Draw the chunks and trains in view, trains sliding between the
+        // last two ticks
+        syncSwitchTiles(default_context, snapshot.switch_state);
+        drawStaticLayer(window, default_context);
+        drawTrains(window, default_context, previousSnapshot(), snapshot, snapshotAlpha());
 
         // Draw UI text
         sf::Text infoText;
         infoText.setFont(font);
         infoText.setCharacterSize(18);
         infoText.setFillColor(sf::Color::White);
-        infoText.setString("Tick: " + to_string(current_tick) + 
-                          (isPaused ? " [PAUSED]" : "") +
-                          "\nPress SPACE to pause/resume\nPress . to step");
+        ostringstream rate;
+        rate << fixed << setprecision(achievedRate < 10.f ? 1 : 0) << achievedRate;
+        infoText.setString("Tick: " + to_string(snapshot.tick) +
+                          (isSimPaused() ? " [PAUSED]" : "") +
+                          "\nSpeed: " + speedLabel() + " (" + rate.str() + " ticks/s)" +
+                          "\nPress SPACE to pause/resume\nPress . to step"
+                          "\n[ ] to change speed, 0 for max, 1 for normal"
+                          "\nArrows or middle-drag to pan, wheel or +/- to zoom");
         infoText.setPosition(10, 10);
         
         // Draw text in screen coordinates (not world)
@@ -216,6 +212,9 @@ void runApp() {
 
         window.display();
     }
+
+    // The caller writes metrics from default_context next
+    stopSimThread();
 }
 
 void cleanupApp() {
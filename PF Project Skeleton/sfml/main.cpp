@@ -1,98 +1,89 @@
 #include <iostream>
 #include <string>
 #include <cstdlib>
+#include <cstdio>
 #include <ctime>
+#include <chrono>
+#include <thread>
 #include "../core/simulation_state.h"
 #include "../core/simulation.h"
 #include "../core/io.h"
+#include "../core/log_sink.h"
+#include "../core/workers.h"
+#include "../core/level_cache.h"
+#include "../core/checkpoint.h"
+#include "../core/state_hash.h"
+#include "../core/log.h"
 #include "app.h" 
+#include "terminal.h"
 
 using namespace std;
 
-static void clearScreen() {
-    #ifdef _WIN32
-        system("cls");
-    #else
-        system("clear");
-    #endif
+static void sleepMs(int milliseconds) {
+    this_thread::sleep_for(chrono::milliseconds(milliseconds));
 }
 
-static void sleepMs(int milliseconds) {
-    clock_t start = clock();
-    clock_t end = start + (milliseconds * CLOCKS_PER_SEC / 1000);
-    while (clock() < end) {
-        // Busy wait
-    }
+// Where to save the state when a headless/bench run stops (--checkpoint)
+static string checkpointPath;
+
+static void saveRunCheckpoint() {
+    if (checkpointPath.empty()) return;
+    if (saveCheckpoint(checkpointPath))
+        cout << "Checkpoint at tick " << current_tick << " saved to " << checkpointPath << "\n";
 }
 
-static char getTrainSymbol(int direction) {
-    switch(direction) {
-        case DIR_UP: return '^';
-        case DIR_DOWN: return 'v';
-        case DIR_LEFT: return '<';
-        case DIR_RIGHT: return '>';
-        default: return '*';
-    }
+static void printUsage(const char* prog) {
+    cout << "Usage: " << prog << " <level_file.lvl> [--view | --bench] [maxTicks]\n";
+    cout << " Example: " << prog << " data/levels/easy_level.lvl --view 1000\n";
+    cout << " --bench (or --fast) runs unpaced with no terminal output and reports throughput\n";
+    cout << " --binary-trace writes out/trace.bin (columnar) instead of out/trace.csv\n";
+    cout << " --log-level L sets the log level: error, warn, info (default), debug or trace\n";
+    cout << " --viewport X,Y sets the top-left tile shown when the map is larger than the terminal\n";
+    cout << " --threads N splits routing and movement of large levels across N threads\n";
+    cout << " --checkpoint <file> saves the simulation state when a headless/bench run stops\n";
+    cout << " --verify runs the level twice (serial and with the --threads pool) and compares state hashes\n";
+    cout << " --verify-hashes <hashes.csv> reruns the level and compares against a hashes.csv from an earlier run\n";
+    cout << "       " << prog << " --resume <file> [options] continues from a saved checkpoint\n";
+    cout << "       " << prog << " --trace-to-csv <trace.bin> <trace.csv>\n";
+    cout << "       " << prog << " --compile <level.lvl> [level.lvlc]\n";
+    cout << " A level.lvlc next to level.lvl is loaded instead of parsing while it is up to date\n";
 }
 
-static void printAsciiGrid() {
-    clearScreen();
-    
-    cout << "========================================\n";
-    cout << "Tick: " << current_tick << "\n";
-    cout << "Grid: " << grid_rows << " rows x " << grid_cols << " cols\n";
-    cout << "========================================\n";
-    
-    // Count active trains
-    int activeCount = 0;
-    int finishedCount = 0;
-    for (int t = 0; t < total_trains; ++t) {
-        if (train_active[t]) activeCount++;
-        if (train_finished[t]) finishedCount++;
-    }
-    cout << "Active: " << activeCount << " | Finished: " << finishedCount << " / " << total_trains << "\n\n";
-    
-    for (int r = 0; r < grid_rows; ++r) {
-        for (int c = 0; c < grid_cols; ++c) {
-            char ch = grid[r][c];
-
-            bool printedTrain = false;
-            for (int t = 0; t < total_trains; ++t) {
-                if (train_active[t] && train_x[t] == c && train_y[t] == r) {
-                    cout << getTrainSymbol(train_direction[t]);
-                    printedTrain = true;
-                    break;
-                }
-            }
-            if (printedTrain) continue;
+// ----------------------------------------------------------------------------
+// Unpaced benchmark run: no sleeps, no grid drawing, no per-tick stdout.
+// Trace/switch CSVs and metrics are still written so results can be checked.
+// ----------------------------------------------------------------------------
+static int runBenchmark(int maxTicks) {
+    int tickCount = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
 
-            if (ch == '\0' || ch == ' ' || ch == '.') cout << ' ';  
-            else cout << ch;
-        }
-        cout << "\n";
-    }
+    while (maxTicks < 0 || tickCount < maxTicks) {
+        tickCount += fastForwardIdleTicks(maxTicks < 0 ? -1 : maxTicks - tickCount);
+        if (maxTicks >= 0 && tickCount >= maxTicks) break;
 
-    cout << "\n--- Train Details ---\n";
-    for (int t = 0; t < total_trains; ++t) {
-        cout << "Train " << t << ": ";
-        if (train_finished[t]) {
-            cout << "FINISHED at tick " << train_arrival_tick[t];
-        } else if (train_active[t]) {
-            cout << "ACTIVE pos=(" << (train_x[t] + 1) << "," << (train_y[t] + 1) << ")"
-                 << " dir=" << getTrainSymbol(train_direction[t])
-                 << " dest=(" << (train_dest_x[t] + 1) << "," << (train_dest_y[t] + 1) << ")";
-        } else {
-            cout << "INACTIVE (spawns at tick " << train_spawn_tick[t] << ")";
-        }
-        cout << "\n";
+        simulateOneTick();
+        ++tickCount;
+        if (isSimulationComplete()) break;
     }
-    
-    cout << flush;
-}
 
-static void printUsage(const char* prog) {
-    cout << "Usage: " << prog << " <level_file.lvl> [--view] [maxTicks]\n";
-    cout << " Example: " << prog << " data/levels/easy_level.lvl --view 1000\n";
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    double seconds = chrono::duration<double>(end - start).count();
+
+    saveRunCheckpoint();
+    closeLogFiles();
+    writeMetrics();
+
+    int delivered = 0;
+    for (int i = 0; i < total_trains; ++i)
+        if (train_finished[i]) delivered++;
+
+    cout << "Benchmark: " << tickCount << " ticks in " << (seconds * 1000.0) << " ms";
+    if (seconds > 0.0) cout << " (" << (tickCount / seconds) << " ticks/sec)";
+    cout << "\n";
+    cout << "Delivered: " << delivered << " / " << total_trains
+         << " | final tick " << current_tick
+         << (isSimulationComplete() ? " [complete]" : " [stopped at maxTicks]") << "\n";
+    return 0;
 }
 
 int main(int argc, char** argv) {
@@ -101,44 +92,113 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+    if (string(argv[1]) == "--trace-to-csv") {
+        if (argc < 4) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return convertBinaryTraceToCsv(argv[2], argv[3]) ? 0 : 1;
+    }
+
+    if (string(argv[1]) == "--compile") {
+        if (argc < 3) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        string out = (argc >= 4) ? argv[3] : string(argv[2]) + "c";
+        if (!compileLevelFile(argv[2], out)) return 1;
+        cout << "Compiled " << argv[2] << " -> " << out << "\n";
+        return 0;
+    }
+
     string levelPath = "data/levels/easy_level.lvl";
+    string resumePath;
     bool viewMode = false;
+    bool benchMode = false;
     int maxTicks = -1; 
+    bool verifyMode = false;
+    string verifyHashesPath;
 
-    if (argc >= 2) levelPath = argv[1];
-    if (argc >= 3) {
-        string a2 = argv[2];
-        if (a2 == "--view") viewMode = true;
-        else maxTicks = atoi(argv[2]);
+    int firstOption = 2;
+    if (string(argv[1]) == "--resume" && argc >= 3) {
+        resumePath = argv[2];
+        firstOption = 3;
+    } else {
+        levelPath = argv[1];
     }
-    if (argc >= 4) {
-        string a3 = argv[3];
-        if (a3 == "--view") viewMode = true;
-        else maxTicks = atoi(argv[3]);
+    for (int a = firstOption; a < argc; ++a) {
+        string arg = argv[a];
+        if (arg == "--view") viewMode = true;
+        else if (arg == "--bench" || arg == "--fast") benchMode = true;
+        else if (arg == "--binary-trace") setTraceFormat(TRACE_FORMAT_BINARY);
+        else if (arg == "--threads" && a + 1 < argc) setWorkerThreads(atoi(argv[++a]));
+        else if (arg == "--checkpoint" && a + 1 < argc) checkpointPath = argv[++a];
+        else if (arg == "--verify") verifyMode = true;
+        else if (arg == "--log-level" && a + 1 < argc) {
+            if (!parseLogLevel(argv[++a], log_level)) {
+                cerr << "Unknown log level: " << argv[a] << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "--verify-hashes" && a + 1 < argc) verifyHashesPath = argv[++a];
+        else if (arg == "--viewport" && a + 1 < argc) {
+            int x = 0, y = 0;
+            if (sscanf(argv[++a], "%d,%d", &x, &y) != 2) {
+                cerr << "Bad viewport (expected X,Y): " << argv[a] << "\n";
+                return 1;
+            }
+            setTerminalViewport(x - 1, y - 1);
+        }
+        else maxTicks = atoi(argv[a]);
     }
 
-    cout << "Switchback Rails - starting with level: " << levelPath << endl;
+    if (resumePath.empty() && verifyMode) {
+        return verifyDeterminism(levelPath, maxTicks) ? 0 : 1;
+    }
+    if (resumePath.empty() && !verifyHashesPath.empty()) {
+        return verifyAgainstHashes(levelPath, verifyHashesPath, maxTicks) ? 0 : 1;
+    }
 
     initializeSimulationState();
 
-    if (!loadLevelFile(levelPath)) {
-        cerr << "Failed to load level: " << levelPath << endl;
-        return 1;
+    if (!resumePath.empty()) {
+        cout << "Switchback Rails - resuming from checkpoint: " << resumePath << endl;
+        if (!loadCheckpoint(resumePath)) {
+            cerr << "Failed to load checkpoint: " << resumePath << endl;
+            return 1;
+        }
+        if (current_tick > 0 && isSimulationComplete()) {
+            cout << "Checkpoint is of a finished run (tick " << current_tick << "), nothing to resume.\n";
+            return 0;
+        }
+    } else {
+        cout << "Switchback Rails - starting with level: " << levelPath << endl;
+        if (!loadLevel(levelPath)) {
+            cerr << "Failed to load level: " << levelPath << endl;
+            return 1;
+        }
     }
 
     cout << "Level loaded: grid " << grid_rows << "x" << grid_cols
          << " total_trains=" << total_trains << "\n";
 
     for (int i = 0; i < total_trains; ++i) {
-        cout << "Train " << i << " spawnTick=" << train_spawn_tick[i]
-             << " pos=(" << train_x[i] << "," << train_y[i] << ") dir=" << train_direction[i]
-             << " dest=(" << train_dest_x[i] << "," << train_dest_y[i] << ")"
-             << " color=" << train_color[i] << "\n";
+        LOG_DEBUG("Train " << i << " spawnTick=" << train_spawn_tick[i]
+                  << " pos=(" << train_x[i] << "," << train_y[i] << ") dir=" << train_direction[i]
+                  << " dest=(" << train_dest_x[i] << "," << train_dest_y[i] << ")"
+                  << " color=" << train_color[i]);
     }
 
-    initializeLogFiles();
+    // A resumed run continues the interrupted run's logs
+    if (resumePath.empty()) initializeLogFiles();
+    else resumeLogFiles();
 
-    initializeSimulation();
+    // A resumed run keeps the checkpoint's RNG state
+    if (resumePath.empty()) initializeSimulation();
+
+    if (benchMode) {
+        return runBenchmark(maxTicks);
+    }
 
     if (!viewMode) {
         cout << "Running headless simulation...\n";
@@ -146,32 +206,41 @@ int main(int argc, char** argv) {
         sleepMs(2000);
 
         int tickCount = 0;
-        printAsciiGrid();
+        initializeTerminal();
+        drawTerminalFrame();
 
         while (true) {
             if (maxTicks >= 0 && tickCount >= maxTicks) {
+                closeTerminal();
                 cout << "Reached maxTicks=" << maxTicks << ", stopping.\n";
                 break;
             }
 
+            // Nothing moves before the next spawn: skip the idle stretch
+            tickCount += fastForwardIdleTicks(maxTicks < 0 ? -1 : maxTicks - tickCount);
+            if (maxTicks >= 0 && tickCount >= maxTicks) continue;
+
             sleepMs(500);
 
+            // simulateOneTick() logs the tick's trace and switch rows
             simulateOneTick();
             ++tickCount;
 
-            // log every tick's data
-            logTrainTrace();
-            logSwitchState();
+            // Paced run is stopped with Ctrl+C, so keep the files current
+            flushLogStreams();
 
-            printAsciiGrid();
+            drawTerminalFrame();
 
             if (isSimulationComplete()) {
+                closeTerminal();
                 cout << "\n*** SIMULATION COMPLETE at tick " << current_tick << " ***\n";
                 break;
             }
         }
 
         // Write final metrics
+        saveRunCheckpoint();
+        closeLogFiles();
         writeMetrics();             
         cout << "Metrics written to out/ directory. Exiting.\n";
         return 0;
@@ -187,6 +256,7 @@ int main(int argc, char** argv) {
     cleanupApp();
 
     // Write metrics after viewer closes
+    closeLogFiles();
     writeMetrics();
     cout << "Viewer closed. Metrics written to out/ directory. Exiting.\n";
     return 0;
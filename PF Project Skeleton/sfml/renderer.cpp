@@ -0,0 +1,375 @@
+#include "renderer.h"
+#include "../core/switches.h"
+#include "../core/log.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+// ============================================================================
+// RENDERER.CPP - Sprite atlas, track layer and train quads
+// ============================================================================
+
+enum AtlasCell {
+    CELL_TRACK_H, CELL_TRACK_V, CELL_CROSS, CELL_CURVE_SLASH, CELL_CURVE_BACKSLASH,
+    CELL_SWITCH_STRAIGHT, CELL_SWITCH_TURN, CELL_SOURCE, CELL_DEST,
+    CELL_TRAIN_UP, CELL_TRAIN_RIGHT, CELL_TRAIN_DOWN, CELL_TRAIN_LEFT,
+    CELL_COUNT
+};
+
+struct AtlasSprite {
+    const char *path;
+    sf::Color fallback;  // drawn instead when the file is missing
+};
+
+static const AtlasSprite ATLAS_SPRITES[CELL_COUNT] = {
+    {"Sprites/track_horizontal.png", sf::Color(150, 150, 150)},
+    {"Sprites/track_vertical.png", sf::Color(150, 150, 150)},
+    {"Sprites/track_cross.png", sf::Color(190, 190, 190)},
+    {"Sprites/track_diagonal_up.png", sf::Color(150, 150, 150)},
+    {"Sprites/track_diagonal_down.png", sf::Color(150, 150, 150)},
+    {"Sprites/switch_A.png", sf::Color(80, 160, 230)},
+    {"Sprites/switch_B.png", sf::Color(230, 160, 60)},
+    {"Sprites/tile_source_tile.png", sf::Color(60, 120, 230)},
+    {"Sprites/tile_destination_tile.png", sf::Color(220, 60, 60)},
+    {"Sprites/train_up.png", sf::Color(240, 220, 60)},
+    {"Sprites/train_right.png", sf::Color(240, 220, 60)},
+    {"Sprites/train_down.png", sf::Color(240, 220, 60)},
+    {"Sprites/train_left.png", sf::Color(240, 220, 60)},
+};
+
+static const int ATLAS_CELL = 64;
+static const int ATLAS_COLUMNS = 4;
+
+// Trains are drawn a little smaller than a tile
+static const float TRAIN_SCALE = 0.8f;
+static const sf::Color TRAIN_DOT_COLOR(255, 235, 60);
+
+// Below this many screen pixels per tile the overview is drawn instead of
+// the sprites, and trains become dots
+static const float LOD_PIXELS_PER_TILE = 6.f;
+
+// Chunks not drawn in the current frame are freed once more than this many
+// hold geometry
+static const int MAX_CACHED_CHUNKS = 512;
+
+static sf::Texture atlas;
+
+// Sprite geometry of one CHUNK_TILES x CHUNK_TILES block, built on first use
+// and rebuilt after one of its tiles changed.
+struct TrackChunk {
+    vector<sf::Vertex> quads;
+    bool dirty;
+    long long lastDrawn;  // frame number
+};
+
+// One pixel per tile for one OVERVIEW_TILES x OVERVIEW_TILES block
+struct OverviewRegion {
+    sf::Texture pixels;
+    bool built;
+};
+
+static int chunkCols = 0, chunkRows = 0;
+static vector<TrackChunk> chunks;
+static int cachedChunks = 0;
+
+static int regionCols = 0, regionRows = 0;
+static vector<OverviewRegion> regions;
+
+static vector<int> drawnSwitchState;
+static long long frameNumber = 0;
+
+static sf::VertexArray trainLayer(sf::Quads);
+
+// ----------------------------------------------------------------------------
+// ATLAS
+// ----------------------------------------------------------------------------
+static sf::Vector2f cellOrigin(int cell) {
+    return sf::Vector2f((float)(cell % ATLAS_COLUMNS * ATLAS_CELL), (float)(cell / ATLAS_COLUMNS * ATLAS_CELL));
+}
+
+bool initializeRenderer() {
+    int atlasRows = (CELL_COUNT + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+    sf::RenderTexture packer;
+    if (!packer.create(ATLAS_COLUMNS * ATLAS_CELL, atlasRows * ATLAS_CELL)) {
+        LOG_ERROR("Error: Cannot create the sprite atlas");
+        return false;
+    }
+    packer.clear(sf::Color::Transparent);
+
+    // Every sprite is scaled into its cell, whatever its own size
+    for (int c = 0; c < CELL_COUNT; c++) {
+        sf::Vector2f origin = cellOrigin(c);
+        sf::Texture tex;
+        if (tex.loadFromFile(ATLAS_SPRITES[c].path)) {
+            tex.setSmooth(true);
+            sf::Sprite sprite(tex);
+            sprite.setScale((float)ATLAS_CELL / tex.getSize().x, (float)ATLAS_CELL / tex.getSize().y);
+            sprite.setPosition(origin);
+            packer.draw(sprite);
+        } else {
+            LOG_WARN("Warning: failed to load texture: " << ATLAS_SPRITES[c].path);
+            sf::RectangleShape box(sf::Vector2f(ATLAS_CELL - 8.f, ATLAS_CELL - 8.f));
+            box.setPosition(origin.x + 4.f, origin.y + 4.f);
+            box.setFillColor(ATLAS_SPRITES[c].fallback);
+            packer.draw(box);
+        }
+    }
+    packer.display();
+
+    atlas = packer.getTexture();
+    atlas.setSmooth(true);
+    return true;
+}
+
+// Point the quad at (x, y) with the given size to an atlas cell. The texture
+// rectangle is inset by half a texel so neighbouring cells never bleed in.
+static void setQuad(sf::Vertex *quad, float x, float y, float size, int cell) {
+    sf::Vector2f uv = cellOrigin(cell);
+    float u0 = uv.x + 0.5f, v0 = uv.y + 0.5f;
+    float u1 = uv.x + ATLAS_CELL - 0.5f, v1 = uv.y + ATLAS_CELL - 0.5f;
+
+    quad[0].position = sf::Vector2f(x, y);
+    quad[1].position = sf::Vector2f(x + size, y);
+    quad[2].position = sf::Vector2f(x + size, y + size);
+    quad[3].position = sf::Vector2f(x, y + size);
+    quad[0].texCoords = sf::Vector2f(u0, v0);
+    quad[1].texCoords = sf::Vector2f(u1, v0);
+    quad[2].texCoords = sf::Vector2f(u1, v1);
+    quad[3].texCoords = sf::Vector2f(u0, v1);
+    for (int k = 0; k < 4; k++) quad[k].color = sf::Color::White;
+}
+
+// ----------------------------------------------------------------------------
+// TRACK LAYER
+// ----------------------------------------------------------------------------
+// Atlas cell for a tile, or -1 if nothing is drawn there.
+static int tileCell(const SimulationContext &ctx, int x, int y) {
+    int s = getSwitchIndex(ctx, x, y);
+    if (s != -1) return (drawnSwitchState[s] == 1) ? CELL_SWITCH_TURN : CELL_SWITCH_STRAIGHT;
+
+    char t = ctx.grid[y][x];
+    switch (t) {
+        case '-': case '=': return CELL_TRACK_H;
+        case '|': return CELL_TRACK_V;
+        case '+': return CELL_CROSS;
+        case '/': return CELL_CURVE_SLASH;
+        case '\\': return CELL_CURVE_BACKSLASH;
+        case 'S': return CELL_SOURCE;
+        case 'D': return CELL_DEST;
+        default: break;
+    }
+    // A letter with no switch declared is an ordinary junction
+    return (t >= 'A' && t <= 'Z') ? CELL_CROSS : -1;
+}
+
+static sf::Color overviewColor(const SimulationContext &ctx, int x, int y) {
+    int cell = tileCell(ctx, x, y);
+    return cell == -1 ? sf::Color::Transparent : ATLAS_SPRITES[cell].fallback;
+}
+
+static void buildChunk(const SimulationContext &ctx, int cx, int cy) {
+    TrackChunk &chunk = chunks[cy * chunkCols + cx];
+    int x0 = cx * CHUNK_TILES, y0 = cy * CHUNK_TILES;
+    int x1 = min(x0 + CHUNK_TILES, ctx.grid_cols), y1 = min(y0 + CHUNK_TILES, ctx.grid_rows);
+
+    chunk.quads.clear();
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            int cell = tileCell(ctx, x, y);
+            if (cell == -1) continue;
+            size_t v = chunk.quads.size();
+            chunk.quads.resize(v + 4);
+            setQuad(&chunk.quads[v], x * TILE_PIXELS, y * TILE_PIXELS, TILE_PIXELS, cell);
+        }
+    }
+    chunk.dirty = false;
+}
+
+static void freeChunk(TrackChunk &chunk) {
+    // swap() releases the storage; clear() would keep it
+    vector<sf::Vertex>().swap(chunk.quads);
+    chunk.dirty = true;
+    chunk.lastDrawn = -1;
+    cachedChunks--;
+}
+
+static void buildRegion(const SimulationContext &ctx, int rx, int ry) {
+    OverviewRegion &region = regions[ry * regionCols + rx];
+    int x0 = rx * OVERVIEW_TILES, y0 = ry * OVERVIEW_TILES;
+    int w = min(OVERVIEW_TILES, ctx.grid_cols - x0), h = min(OVERVIEW_TILES, ctx.grid_rows - y0);
+
+    sf::Image image;
+    image.create(w, h, sf::Color::Transparent);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            image.setPixel(x, y, overviewColor(ctx, x0 + x, y0 + y));
+    region.pixels.loadFromImage(image);
+    region.pixels.setSmooth(false);
+    region.built = true;
+}
+
+void buildStaticLayer(const SimulationContext &ctx) {
+    chunkCols = (ctx.grid_cols + CHUNK_TILES - 1) / CHUNK_TILES;
+    chunkRows = (ctx.grid_rows + CHUNK_TILES - 1) / CHUNK_TILES;
+    chunks.clear();
+    chunks.resize((size_t)chunkCols * chunkRows);
+    for (size_t c = 0; c < chunks.size(); c++) {
+        chunks[c].dirty = true;
+        chunks[c].lastDrawn = -1;
+    }
+    cachedChunks = 0;
+
+    regionCols = (ctx.grid_cols + OVERVIEW_TILES - 1) / OVERVIEW_TILES;
+    regionRows = (ctx.grid_rows + OVERVIEW_TILES - 1) / OVERVIEW_TILES;
+    regions.clear();
+    regions.resize((size_t)regionCols * regionRows);
+    for (size_t r = 0; r < regions.size(); r++) regions[r].built = false;
+
+    drawnSwitchState = ctx.switch_state;
+}
+
+void refreshTile(const SimulationContext &ctx, int x, int y) {
+    if (x < 0 || x >= ctx.grid_cols || y < 0 || y >= ctx.grid_rows) return;
+    chunks[(y / CHUNK_TILES) * chunkCols + x / CHUNK_TILES].dirty = true;
+
+    // The overview is patched in place, one pixel
+    OverviewRegion &region = regions[(y / OVERVIEW_TILES) * regionCols + x / OVERVIEW_TILES];
+    if (region.built) {
+        sf::Color c = overviewColor(ctx, x, y);
+        sf::Uint8 pixel[4] = {c.r, c.g, c.b, c.a};
+        region.pixels.update(pixel, 1, 1, x % OVERVIEW_TILES, y % OVERVIEW_TILES);
+    }
+}
+
+void syncSwitchTiles(const SimulationContext &ctx, const vector<int> &switchState) {
+    int count = (int)min(drawnSwitchState.size(), switchState.size());
+    for (int s = 0; s < count; s++) {
+        if (drawnSwitchState[s] == switchState[s]) continue;
+        drawnSwitchState[s] = switchState[s];
+        refreshTile(ctx, ctx.switch_x[s], ctx.switch_y[s]);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// VIEW
+// ----------------------------------------------------------------------------
+// Tile range covered by the target's view, clamped to the grid
+struct TileRange {
+    int x0, y0, x1, y1;  // x1/y1 exclusive
+};
+
+static TileRange visibleTiles(const sf::RenderTarget &target, const SimulationContext &ctx) {
+    const sf::View &view = target.getView();
+    sf::Vector2f half = view.getSize() * 0.5f;
+    sf::Vector2f topLeft = view.getCenter() - half, bottomRight = view.getCenter() + half;
+
+    TileRange r;
+    r.x0 = max(0, (int)floor(topLeft.x / TILE_PIXELS));
+    r.y0 = max(0, (int)floor(topLeft.y / TILE_PIXELS));
+    r.x1 = min(ctx.grid_cols, (int)floor(bottomRight.x / TILE_PIXELS) + 1);
+    r.y1 = min(ctx.grid_rows, (int)floor(bottomRight.y / TILE_PIXELS) + 1);
+    return r;
+}
+
+static float pixelsPerTile(const sf::RenderTarget &target) {
+    return TILE_PIXELS * target.getSize().x / target.getView().getSize().x;
+}
+
+bool isOverviewZoom(const sf::RenderTarget &target) {
+    return pixelsPerTile(target) < LOD_PIXELS_PER_TILE;
+}
+
+static void drawOverview(sf::RenderTarget &target, const SimulationContext &ctx, const TileRange &tiles) {
+    if (tiles.x0 >= tiles.x1 || tiles.y0 >= tiles.y1) return;
+    for (int ry = tiles.y0 / OVERVIEW_TILES; ry <= (tiles.y1 - 1) / OVERVIEW_TILES; ry++) {
+        for (int rx = tiles.x0 / OVERVIEW_TILES; rx <= (tiles.x1 - 1) / OVERVIEW_TILES; rx++) {
+            OverviewRegion &region = regions[ry * regionCols + rx];
+            if (!region.built) buildRegion(ctx, rx, ry);
+            sf::Sprite sprite(region.pixels);
+            sprite.setPosition(rx * OVERVIEW_TILES * TILE_PIXELS, ry * OVERVIEW_TILES * TILE_PIXELS);
+            sprite.setScale(TILE_PIXELS, TILE_PIXELS);
+            target.draw(sprite);
+        }
+    }
+}
+
+void drawStaticLayer(sf::RenderTarget &target, const SimulationContext &ctx) {
+    frameNumber++;
+    TileRange tiles = visibleTiles(target, ctx);
+    if (isOverviewZoom(target)) {
+        drawOverview(target, ctx, tiles);
+        return;
+    }
+    if (tiles.x0 >= tiles.x1 || tiles.y0 >= tiles.y1) return;
+
+    sf::RenderStates states(&atlas);
+    for (int cy = tiles.y0 / CHUNK_TILES; cy <= (tiles.y1 - 1) / CHUNK_TILES; cy++) {
+        for (int cx = tiles.x0 / CHUNK_TILES; cx <= (tiles.x1 - 1) / CHUNK_TILES; cx++) {
+            TrackChunk &chunk = chunks[cy * chunkCols + cx];
+            if (chunk.dirty) {
+                if (chunk.lastDrawn == -1) cachedChunks++;
+                buildChunk(ctx, cx, cy);
+            }
+            chunk.lastDrawn = frameNumber;
+            if (!chunk.quads.empty()) target.draw(&chunk.quads[0], chunk.quads.size(), sf::Quads, states);
+        }
+    }
+
+    // Drop the geometry of chunks that scrolled out of view
+    if (cachedChunks > MAX_CACHED_CHUNKS) {
+        for (size_t c = 0; c < chunks.size(); c++) {
+            if (chunks[c].lastDrawn != -1 && chunks[c].lastDrawn != frameNumber) freeChunk(chunks[c]);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// TRAINS
+// ----------------------------------------------------------------------------
+static int trainCell(int dir) {
+    switch (dir) {
+        case DIR_UP: return CELL_TRAIN_UP;
+        case DIR_DOWN: return CELL_TRAIN_DOWN;
+        case DIR_LEFT: return CELL_TRAIN_LEFT;
+        default: return CELL_TRAIN_RIGHT;
+    }
+}
+
+void drawTrains(sf::RenderTarget &target, const SimulationContext &ctx, const TickSnapshot &prev,
+                const TickSnapshot &cur, float alpha) {
+    TileRange tiles = visibleTiles(target, ctx);
+    bool dots = isOverviewZoom(target);
+
+    // Dots stay at least two screen pixels wide however far out the view is
+    float size = TILE_PIXELS * TRAIN_SCALE;
+    if (dots) size = max(TILE_PIXELS, 2.f * TILE_PIXELS / pixelsPerTile(target));
+    float inset = (TILE_PIXELS - size) * 0.5f;
+
+    trainLayer.clear();
+    for (size_t i = 0; i < cur.train_active.size(); i++) {
+        if (!cur.train_active[i]) continue;
+        int x = cur.train_x[i], y = cur.train_y[i];
+        if (x < tiles.x0 - 1 || x > tiles.x1 || y < tiles.y0 - 1 || y > tiles.y1) continue;
+
+        // Slide from the previous tile; a train that just spawned (or
+        // jumped) is drawn where it is
+        float fx = (float)x, fy = (float)y;
+        if (i < prev.train_active.size() && prev.train_active[i] &&
+            abs(x - prev.train_x[i]) + abs(y - prev.train_y[i]) == 1) {
+            fx = prev.train_x[i] + (x - prev.train_x[i]) * alpha;
+            fy = prev.train_y[i] + (y - prev.train_y[i]) * alpha;
+        }
+
+        size_t v = trainLayer.getVertexCount();
+        trainLayer.resize(v + 4);
+        setQuad(&trainLayer[v], fx * TILE_PIXELS + inset, fy * TILE_PIXELS + inset, size,
+                trainCell(cur.train_direction[i]));
+        if (dots) {
+            for (int k = 0; k < 4; k++) trainLayer[v + k].color = TRAIN_DOT_COLOR;
+        }
+    }
+    target.draw(trainLayer, dots ? sf::RenderStates() : sf::RenderStates(&atlas));
+}
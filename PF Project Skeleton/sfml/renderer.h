@@ -0,0 +1,56 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <SFML/Graphics.hpp>
+#include "../core/simulation_state.h"
+#include "sim_thread.h"
+
+// ============================================================================
+// RENDERER.H - Batched drawing of the grid and trains
+// ============================================================================
+// All sprites are packed into one texture atlas at start-up. The map is cut
+// into CHUNK_TILES x CHUNK_TILES chunks, each a cached quad array (one quad
+// per non-empty tile) that is built the first time it comes into view and
+// rebuilt only after one of its tiles or switches changed. Only chunks that
+// intersect the view are drawn; geometry of chunks out of view is freed when
+// too many are cached.
+//
+// Zoomed far out (a tile under a few screen pixels) the map is drawn from an
+// overview instead: one texture pixel per tile, in OVERVIEW_TILES blocks,
+// and trains become dots. Trains are one more quad array, refilled every
+// frame with the trains in view.
+//
+// Switch states and trains are taken from TickSnapshots, not from the
+// context, so drawing never reads what the simulation thread is writing.
+// The grid and switch positions are only read (they do not change while the
+// simulation runs).
+// ============================================================================
+
+// World size of one tile in pixels
+const float TILE_PIXELS = 32.f;
+
+const int CHUNK_TILES = 32;
+const int OVERVIEW_TILES = 256;
+
+// Build the sprite atlas. Needs an active window (OpenGL context).
+bool initializeRenderer();
+
+// Reset the chunk and overview caches for the current grid (after a load).
+// Reads ctx.switch_state, so call it while the simulation thread is stopped.
+void buildStaticLayer(const SimulationContext &ctx);
+
+// Re-read one tile after its character changed (e.g. a safety tile edit).
+void refreshTile(const SimulationContext &ctx, int x, int y);
+
+// Patch the switch tiles whose state changed since they were last drawn.
+void syncSwitchTiles(const SimulationContext &ctx, const std::vector<int> &switchState);
+
+// True when the target's view is zoomed out past the sprite level of detail.
+bool isOverviewZoom(const sf::RenderTarget &target);
+
+void drawStaticLayer(sf::RenderTarget &target, const SimulationContext &ctx);
+// Trains of `cur`, each slid from its tile in `prev` by alpha (0..1).
+void drawTrains(sf::RenderTarget &target, const SimulationContext &ctx, const TickSnapshot &prev,
+                const TickSnapshot &cur, float alpha);
+
+#endif
@@ -0,0 +1,194 @@
+#include "sim_thread.h"
+#include "../core/simulation_state.h"
+#include "../core/simulation.h"
+#include "../core/log.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+// ============================================================================
+// SIM_THREAD.CPP - Tick thread and snapshot triple buffer
+// ============================================================================
+
+// How long the thread sleeps at most while waiting (paused or between ticks)
+static const double IDLE_WAIT = 0.002;
+
+// Limits on the frame budget set by the render thread
+static const double MIN_FRAME_BUDGET = 0.001;
+static const double MAX_FRAME_BUDGET = 0.1;
+
+// Weight of the newest tick in the running tick-cost average
+static const double TICK_COST_WEIGHT = 0.1;
+
+// Set in the shared slot index when it holds a snapshot the reader has not
+// taken yet
+static const unsigned SLOT_FRESH = 4;
+static const unsigned SLOT_MASK = 3;
+
+static TickSnapshot slots[3];
+static atomic<unsigned> sharedSlot(1);
+static int writerSlot = 0;  // simulation thread only
+static int readerSlot = 2;  // render thread only
+static TickSnapshot previous;
+
+static thread simThread;
+static atomic<bool> simStop(false);
+static atomic<bool> simPaused(false);
+static atomic<int> stepRequests(0);
+static atomic<double> tickInterval(0.5);
+static atomic<double> frameBudget(1.0 / 60);
+static double tickCost = 0.0;  // seconds, simulation thread only
+
+static double nowSeconds() {
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void fillSnapshot(TickSnapshot &s, const SimulationContext &ctx) {
+    // Plain assignment keeps the slot's capacity once it is large enough
+    s.tick = ctx.current_tick;
+    s.complete = isSimulationComplete(ctx);
+    s.time = nowSeconds();
+    s.train_x = ctx.train_x;
+    s.train_y = ctx.train_y;
+    s.train_direction = ctx.train_direction;
+    s.train_active = ctx.train_active;
+    s.switch_state = ctx.switch_state;
+}
+
+// ----------------------------------------------------------------------------
+// SIMULATION THREAD
+// ----------------------------------------------------------------------------
+// Fill the writer slot and swap it with the shared one. Returns the
+// snapshot's complete flag.
+static bool publishSnapshot() {
+    TickSnapshot &s = slots[writerSlot];
+    fillSnapshot(s, default_context);
+    bool complete = s.complete;
+    writerSlot = (int)(sharedSlot.exchange(writerSlot | SLOT_FRESH, memory_order_acq_rel) & SLOT_MASK);
+    return complete;
+}
+
+static void timedTick() {
+    double start = nowSeconds();
+    simulateOneTick();
+    double cost = nowSeconds() - start;
+    tickCost = tickCost > 0.0 ? tickCost + TICK_COST_WEIGHT * (cost - tickCost) : cost;
+}
+
+// Run the ticks that are due, as many as fit in one frame budget, then
+// publish once. With tickInterval 0 every tick is due, which is the
+// uncapped mode; a budget holds at least one tick.
+static bool runDueTicks(double &nextTick) {
+    double now = nowSeconds();
+    double budget = min(max(frameBudget.load(), MIN_FRAME_BUDGET), MAX_FRAME_BUDGET);
+    double budgetEnd = now + budget;
+    double interval = tickInterval.load();
+    bool complete = false;
+    do {
+        timedTick();
+        complete = isSimulationComplete();
+        nextTick += interval;
+        now = nowSeconds();
+    } while (!complete && now >= nextTick && now + tickCost <= budgetEnd && !simPaused.load() && !simStop.load());
+
+    // Ticks that did not fit are dropped, so the next ones do not rush
+    nextTick = max(nextTick, now);
+    return publishSnapshot();
+}
+
+static void simLoop() {
+    double nextTick = nowSeconds() + tickInterval.load();
+    while (!simStop.load()) {
+        if (stepRequests.load() > 0) {
+            stepRequests--;
+            timedTick();
+            LOG_DEBUG("Manual step: tick " << current_tick);
+            publishSnapshot();
+            continue;
+        }
+        if (simPaused.load()) {
+            nextTick = nowSeconds() + tickInterval.load();
+            this_thread::sleep_for(chrono::duration<double>(IDLE_WAIT));
+            continue;
+        }
+
+        double now = nowSeconds();
+        if (now < nextTick) {
+            this_thread::sleep_for(chrono::duration<double>(min(nextTick - now, IDLE_WAIT)));
+            continue;
+        }
+        if (runDueTicks(nextTick)) {
+            LOG_INFO("\n*** SIMULATION COMPLETE at tick " << current_tick << " ***");
+            simPaused = true;
+        }
+    }
+}
+
+void startSimThread(double interval, bool paused) {
+    // Both sides start from the state as it is now
+    fillSnapshot(slots[readerSlot], default_context);
+    previous = slots[readerSlot];
+
+    tickInterval = interval;
+    simStop = false;
+    simPaused = paused;
+    stepRequests = 0;
+    simThread = thread(simLoop);
+}
+
+void stopSimThread() {
+    if (!simThread.joinable()) return;
+    simStop = true;
+    simThread.join();
+}
+
+void setSimPaused(bool paused) {
+    simPaused = paused;
+}
+
+bool isSimPaused() {
+    return simPaused.load();
+}
+
+void requestSimStep() {
+    stepRequests++;
+}
+
+void setSimTickInterval(double interval) {
+    tickInterval = max(0.0, interval);
+}
+
+void setSimFrameBudget(double seconds) {
+    frameBudget = seconds;
+}
+
+// ----------------------------------------------------------------------------
+// RENDER THREAD
+// ----------------------------------------------------------------------------
+bool pollSnapshot() {
+    if (!(sharedSlot.load(memory_order_acquire) & SLOT_FRESH)) return false;
+
+    // Our slot goes back to the writer, so keep a copy of it first
+    previous = slots[readerSlot];
+    readerSlot = (int)(sharedSlot.exchange(readerSlot, memory_order_acq_rel) & SLOT_MASK);
+    return true;
+}
+
+const TickSnapshot &currentSnapshot() {
+    return slots[readerSlot];
+}
+
+const TickSnapshot &previousSnapshot() {
+    return previous;
+}
+
+float snapshotAlpha() {
+    // A step after a long pause still moves at the normal pace
+    const TickSnapshot &cur = slots[readerSlot];
+    double span = min(cur.time - previous.time, tickInterval.load());
+    if (cur.tick != previous.tick + 1 || span <= 0.0) return 1.f;
+    return (float)min(1.0, (nowSeconds() - cur.time) / span);
+}
@@ -0,0 +1,71 @@
+#ifndef SIM_THREAD_H
+#define SIM_THREAD_H
+
+#include <vector>
+
+// ============================================================================
+// SIM_THREAD.H - Simulation thread for the viewer
+// ============================================================================
+// The viewer runs simulateOneTick() on its own thread, so a slow tick never
+// stalls a frame and a slow frame never stalls a tick. After every tick the
+// thread publishes a TickSnapshot (train positions/directions, switch
+// states) through a lock-free triple buffer: the simulation thread fills
+// one slot, the render thread reads another and the third is swapped
+// between them with a single atomic exchange.
+//
+// Ticks are paced by a tick interval. Ticks that fall due together (a short
+// interval, or 0 for uncapped) are run back to back until the next would
+// overrun the frame budget, using the measured average tick cost, and only
+// then published, so the snapshot copy is made about once per frame
+// however fast the simulation runs.
+//
+// The render thread keeps the last two snapshots it received, so trains can
+// be drawn interpolated between them. While the thread runs, only it may
+// touch default_context; the render thread reads snapshots only.
+// ============================================================================
+
+struct TickSnapshot {
+    int tick;
+    bool complete;  // isSimulationComplete() after this tick
+    double time;    // seconds (steady clock) when the tick was published
+
+    std::vector<int> train_x;
+    std::vector<int> train_y;
+    std::vector<int> train_direction;
+    std::vector<char> train_active;
+    std::vector<int> switch_state;
+};
+
+// Start ticking default_context every `tickInterval` seconds (paused or not).
+void startSimThread(double tickInterval, bool paused);
+
+// Stop the thread and wait for it; default_context is the caller's again.
+void stopSimThread();
+
+void setSimPaused(bool paused);
+bool isSimPaused();
+
+// Run one tick as soon as possible, paused or not.
+void requestSimStep();
+
+// Seconds between ticks; 0 runs ticks as fast as they go.
+void setSimTickInterval(double interval);
+
+// Time the simulation thread may spend on ticks between two snapshots,
+// normally the measured frame time.
+void setSimFrameBudget(double seconds);
+
+// Move to the newest published snapshot, if there is one. Returns true when
+// `current` changed; the snapshot it replaced becomes `previous`.
+bool pollSnapshot();
+
+// Valid until the next pollSnapshot() (the slot then goes back to the
+// simulation thread).
+const TickSnapshot &currentSnapshot();
+const TickSnapshot &previousSnapshot();
+
+// How far the render clock is from previousSnapshot() to currentSnapshot(),
+// in [0, 1], assuming the next tick takes as long as the last one.
+float snapshotAlpha();
+
+#endif
@@ -0,0 +1,300 @@
+#include "terminal.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#ifndef _WIN32
+#include <cerrno>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#endif
+
+using namespace std;
+
+// ============================================================================
+// TERMINAL.CPP - Diff-based frame output for headless runs
+// ============================================================================
+
+// Used when the terminal size cannot be queried (and LINES/COLUMNS unset)
+static const int DEFAULT_ROWS = 24;
+static const int DEFAULT_COLS = 80;
+
+// Banner (4 lines), train counts and a blank line above the map
+static const int HEADER_ROWS = 6;
+
+// Unchanged cells up to this many between two changes are sent again
+// rather than paying for another cursor move
+static const int MAX_RUN_GAP = 6;
+
+static const char BANNER[] = "========================================";
+
+static int viewX = 0, viewY = 0;
+
+// Character cells of the frame being composed and of what the terminal
+// shows now, screenRows x screenCols
+static int screenRows = 0, screenCols = 0;
+static vector<char> frame;
+static vector<char> shown;
+static bool fullRedraw = true;
+static bool terminalOpen = false;
+
+// Train drawn on each tile (-1 for none), and the tiles set last frame so
+// only those are cleared
+static vector<int> occupant;
+static vector<int> occupiedTiles;
+
+static string output;
+
+// ----------------------------------------------------------------------------
+// TERMINAL ACCESS
+// ----------------------------------------------------------------------------
+static void terminalSize(int &rows, int &cols) {
+#ifndef _WIN32
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        rows = ws.ws_row;
+        cols = ws.ws_col;
+        return;
+    }
+#endif
+    const char *lines = getenv("LINES");
+    const char *columns = getenv("COLUMNS");
+    rows = (lines && atoi(lines) > 0) ? atoi(lines) : DEFAULT_ROWS;
+    cols = (columns && atoi(columns) > 0) ? atoi(columns) : DEFAULT_COLS;
+}
+
+// Write the whole string with one call (more only if the write is partial).
+static void writeOut(const string &s) {
+    // Anything still buffered in cout/stdout has to go first
+    cout.flush();
+    fflush(stdout);
+#ifndef _WIN32
+    size_t done = 0;
+    while (done < s.size()) {
+        ssize_t n = write(STDOUT_FILENO, s.data() + done, s.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        done += (size_t)n;
+    }
+#else
+    fwrite(s.data(), 1, s.size(), stdout);
+    fflush(stdout);
+#endif
+}
+
+#ifndef _WIN32
+// Ctrl+C ends a paced run; give the cursor back before the default action
+static void restoreCursorOnSignal(int sig) {
+    static const char SHOW_CURSOR[] = "\x1b[?25h\n";
+    if (write(STDOUT_FILENO, SHOW_CURSOR, sizeof(SHOW_CURSOR) - 1) < 0) {}
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+#endif
+
+static void appendCursorMove(string &out, int row, int col) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "\x1b[%d;%dH", row + 1, col + 1);
+    out += buf;
+}
+
+void setTerminalViewport(int x, int y) {
+    viewX = max(0, x);
+    viewY = max(0, y);
+}
+
+void initializeTerminal() {
+    screenRows = screenCols = 0;
+    fullRedraw = true;
+    terminalOpen = true;
+#ifndef _WIN32
+    signal(SIGINT, restoreCursorOnSignal);
+    signal(SIGTERM, restoreCursorOnSignal);
+#endif
+    writeOut("\x1b[?25l");
+}
+
+void closeTerminal() {
+    if (!terminalOpen) return;
+    terminalOpen = false;
+#ifndef _WIN32
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+#endif
+    string out;
+    appendCursorMove(out, screenRows, 0);
+    out += "\x1b[?25h";
+    writeOut(out);
+}
+
+// ----------------------------------------------------------------------------
+// FRAME COMPOSITION
+// ----------------------------------------------------------------------------
+static char getTrainSymbol(int direction) {
+    switch(direction) {
+        case DIR_UP: return '^';
+        case DIR_DOWN: return 'v';
+        case DIR_LEFT: return '<';
+        case DIR_RIGHT: return '>';
+        default: return '*';
+    }
+}
+
+// Write text into the frame at (row, col), clipped to the screen.
+static void putText(int row, int col, const string &text) {
+    if (row < 0 || row >= screenRows || col >= screenCols) return;
+    int n = min((int)text.size(), screenCols - col);
+    if (n > 0) memcpy(&frame[(size_t)row * screenCols + col], text.data(), n);
+}
+
+static string trainLine(const SimulationContext &ctx, int t) {
+    char buf[128];
+    if (ctx.train_finished[t]) {
+        snprintf(buf, sizeof(buf), "Train %d: FINISHED at tick %d", t, ctx.train_arrival_tick[t]);
+    } else if (ctx.train_active[t]) {
+        snprintf(buf, sizeof(buf), "Train %d: ACTIVE pos=(%d,%d) dir=%c dest=(%d,%d)", t, ctx.train_x[t] + 1,
+                 ctx.train_y[t] + 1, getTrainSymbol(ctx.train_direction[t]), ctx.train_dest_x[t] + 1,
+                 ctx.train_dest_y[t] + 1);
+    } else {
+        snprintf(buf, sizeof(buf), "Train %d: INACTIVE (spawns at tick %d)", t, ctx.train_spawn_tick[t]);
+    }
+    return buf;
+}
+
+static void composeMap(const SimulationContext &ctx, int top, int mapRows, int mapCols) {
+    // Lowest-numbered train wins a shared tile
+    for (size_t k = 0; k < occupiedTiles.size(); k++) occupant[occupiedTiles[k]] = -1;
+    occupiedTiles.clear();
+    for (int t = ctx.total_trains - 1; t >= 0; t--) {
+        if (!ctx.train_active[t]) continue;
+        int tile = tileIndex(ctx, ctx.train_x[t], ctx.train_y[t]);
+        occupant[tile] = t;
+        occupiedTiles.push_back(tile);
+    }
+
+    for (int r = 0; r < mapRows; r++) {
+        char *row = &frame[(size_t)(top + r) * screenCols];
+        int y = viewY + r;
+        for (int c = 0; c < mapCols; c++) {
+            int x = viewX + c;
+            int t = occupant[tileIndex(ctx, x, y)];
+            char ch = ctx.grid[y][x];
+            if (t != -1) row[c] = getTrainSymbol(ctx.train_direction[t]);
+            else row[c] = (ch == '\0' || ch == ' ' || ch == '.') ? ' ' : ch;
+        }
+    }
+}
+
+static void composeTrainList(const SimulationContext &ctx, int top) {
+    int lines = screenRows - top - 1;
+    if (lines <= 0 || ctx.total_trains == 0) return;
+    putText(top, 0, "--- Train Details ---");
+
+    // Active trains first, then the rest in order, as many as fit
+    int listed = 0;
+    bool truncated = false;
+    for (int pass = 0; pass < 2 && !truncated; pass++) {
+        for (int t = 0; t < ctx.total_trains; t++) {
+            if ((ctx.train_active[t] != 0) != (pass == 0)) continue;
+            if (listed == lines - 1 && ctx.total_trains - listed > 1) {
+                truncated = true;
+                break;
+            }
+            putText(top + 1 + listed++, 0, trainLine(ctx, t));
+        }
+    }
+    if (truncated) putText(top + 1 + listed, 0, "... " + to_string(ctx.total_trains - listed) + " more trains");
+}
+
+// ----------------------------------------------------------------------------
+// OUTPUT
+// ----------------------------------------------------------------------------
+// Append runs of changed cells to `output` and mark them shown.
+static void diffFrame() {
+    for (int r = 0; r < screenRows; r++) {
+        const char *now = &frame[(size_t)r * screenCols];
+        char *was = &shown[(size_t)r * screenCols];
+        int c = 0;
+        while (c < screenCols) {
+            if (now[c] == was[c]) {
+                c++;
+                continue;
+            }
+            int end = c + 1;
+            for (int k = c + 1; k < screenCols; k++) {
+                if (now[k] != was[k]) end = k + 1;
+                else if (k - end >= MAX_RUN_GAP) break;
+            }
+            appendCursorMove(output, r, c);
+            output.append(now + c, end - c);
+            memcpy(was + c, now + c, end - c);
+            c = end;
+        }
+    }
+}
+
+void drawTerminalFrame(const SimulationContext &ctx) {
+    int rows, cols;
+    terminalSize(rows, cols);
+    rows -= 1;  // the last line stays free so the terminal never scrolls
+    if (rows != screenRows || cols != screenCols) {
+        screenRows = max(rows, 1);
+        screenCols = cols;
+        fullRedraw = true;
+    }
+    frame.assign((size_t)screenRows * screenCols, ' ');
+    if (occupant.size() != (size_t)ctx.grid_rows * ctx.grid_cols) {
+        occupant.assign((size_t)ctx.grid_rows * ctx.grid_cols, -1);
+        occupiedTiles.clear();
+    }
+
+    // Map viewport: the map gets every row below the header it needs
+    int mapRows = min(ctx.grid_rows, max(0, screenRows - HEADER_ROWS));
+    int mapCols = min(ctx.grid_cols, screenCols);
+    viewX = min(viewX, ctx.grid_cols - mapCols);
+    viewY = min(viewY, ctx.grid_rows - mapRows);
+
+    int activeCount = 0, finishedCount = 0;
+    for (int t = 0; t < ctx.total_trains; ++t) {
+        if (ctx.train_active[t]) activeCount++;
+        if (ctx.train_finished[t]) finishedCount++;
+    }
+
+    string gridLine = "Grid: " + to_string(ctx.grid_rows) + " rows x " + to_string(ctx.grid_cols) + " cols";
+    if (mapRows < ctx.grid_rows || mapCols < ctx.grid_cols) {
+        gridLine += "  (showing cols " + to_string(viewX + 1) + "-" + to_string(viewX + mapCols) + ", rows " +
+                    to_string(viewY + 1) + "-" + to_string(viewY + mapRows) + ")";
+    }
+    putText(0, 0, BANNER);
+    putText(1, 0, "Tick: " + to_string(ctx.current_tick));
+    putText(2, 0, gridLine);
+    putText(3, 0, BANNER);
+    putText(4, 0, "Active: " + to_string(activeCount) + " | Finished: " + to_string(finishedCount) + " / " +
+                  to_string(ctx.total_trains));
+
+    composeMap(ctx, HEADER_ROWS, mapRows, mapCols);
+    composeTrainList(ctx, HEADER_ROWS + mapRows + 1);
+
+    output.clear();
+    if (fullRedraw) {
+        output += "\x1b[2J";
+        shown.assign(frame.size(), '\0');
+        fullRedraw = false;
+    }
+    diffFrame();
+    if (output.empty()) return;
+
+    // Park the cursor on the free last line
+    appendCursorMove(output, screenRows, 0);
+    writeOut(output);
+}
+
+// ----------------------------------------------------------------------------
+// DEFAULT-CONTEXT WRAPPERS
+// ----------------------------------------------------------------------------
+
+void drawTerminalFrame() { drawTerminalFrame(default_context); }
@@ -0,0 +1,32 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include "../core/simulation_state.h"
+
+// ============================================================================
+// TERMINAL.H - ANSI terminal view of a headless run
+// ============================================================================
+// Each frame is composed into a character buffer the size of the terminal:
+// a header, the part of the grid that fits (the viewport) with trains on
+// top, and as many train lines as fit below it. Only the cells that differ
+// from the previous frame are sent, as runs placed with ANSI cursor moves,
+// and the whole frame goes out in a single write. The first frame, and the
+// first after the terminal is resized, clears the screen and sends
+// everything.
+// ============================================================================
+
+// Top-left tile of the viewport, for maps larger than the terminal. It is
+// clamped to the grid when drawing.
+void setTerminalViewport(int x, int y);
+
+// Hide the cursor and reset the frame buffers.
+void initializeTerminal();
+
+void drawTerminalFrame(const SimulationContext &ctx);
+void drawTerminalFrame();
+
+// Put the cursor back below the last frame and show it again. Safe to call
+// more than once.
+void closeTerminal();
+
+#endif
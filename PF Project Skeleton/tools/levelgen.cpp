@@ -0,0 +1,336 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+using namespace std;
+
+// ============================================================================
+// LEVELGEN.CPP - Synthetic level generator (make levelgen)
+// ============================================================================
+// Writes a .lvl of any size in the style of complex_network.lvl: track runs
+// ('=' and '|') between junction nodes ('+') laid out on a lattice with
+// `spacing` tiles between nodes. Sources ('S') hang off the left column of
+// nodes, destinations ('D') off the right column and the bottom row.
+//
+// Topologies (which lattice edges get track):
+//   grid    every edge: a full mesh like complex_network.lvl
+//   lattice every horizontal edge, vertical edges in a brick pattern
+//   tree    a random spanning tree of the lattice (no cycles)
+//
+// A share of the nodes (--switch-density) become switches, named J<n> and
+// placed with @x,y, drawn as letters. Trains get random destinations and
+// spawn ticks spread over --span ticks. The same options and seed always
+// produce the same file. Empty tiles are written as '.', so no map row is a
+// blank line (the loader skips those).
+// ============================================================================
+
+struct GenOptions {
+    int rows, cols;
+    int spacing;
+    string topology;
+    double switchDensity;
+    int sources, dests;
+    int trains;
+    int span;
+    unsigned long long seed;
+    string outPath;
+};
+
+// splitmix64: one stream per generator run
+struct GenRandom {
+    uint64_t state;
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, n)
+    int below(int n) { return (int)(next() % (uint64_t)n); }
+
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+struct Terminal {
+    int x, y;
+};
+
+// ----------------------------------------------------------------------------
+// LATTICE
+// ----------------------------------------------------------------------------
+// Node (i, j) sits at column nodeX(i), row nodeY(j). Edge e < hEdges joins
+// (i, j)-(i+1, j); the rest join (i, j)-(i, j+1).
+struct Lattice {
+    int nx, ny, spacing;
+    int x0, y0;
+
+    int nodeX(int i) const { return x0 + i * spacing; }
+    int nodeY(int j) const { return y0 + j * spacing; }
+    int node(int i, int j) const { return j * nx + i; }
+    int hEdges() const { return (nx - 1) * ny; }
+    int edgeCount() const { return hEdges() + nx * (ny - 1); }
+
+    void edgeEnds(int e, int &a, int &b) const {
+        if (e < hEdges()) {
+            int j = e / (nx - 1), i = e % (nx - 1);
+            a = node(i, j);
+            b = node(i + 1, j);
+        } else {
+            e -= hEdges();
+            int j = e / nx, i = e % nx;
+            a = node(i, j);
+            b = node(i, j + 1);
+        }
+    }
+};
+
+static int findRoot(vector<int> &parent, int v) {
+    while (parent[v] != v) {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+    return v;
+}
+
+// Which lattice edges carry track.
+static vector<char> chooseEdges(const Lattice &lat, const string &topology, GenRandom &rng) {
+    int count = lat.edgeCount();
+    vector<char> used(count, 0);
+
+    if (topology == "grid") {
+        used.assign(count, 1);
+    } else if (topology == "lattice") {
+        for (int e = 0; e < count; e++) {
+            if (e < lat.hEdges()) {
+                used[e] = 1;
+            } else {
+                int v = e - lat.hEdges();
+                int j = v / lat.nx, i = v % lat.nx;
+                used[e] = ((i + j) % 2 == 0) ? 1 : 0;
+            }
+        }
+    } else {
+        // Random spanning tree: Kruskal over shuffled edges
+        vector<int> order(count);
+        for (int e = 0; e < count; e++) order[e] = e;
+        for (int e = count - 1; e > 0; e--) swap(order[e], order[rng.below(e + 1)]);
+
+        vector<int> parent(lat.nx * lat.ny);
+        for (size_t v = 0; v < parent.size(); v++) parent[v] = (int)v;
+        for (int k = 0; k < count; k++) {
+            int a, b;
+            lat.edgeEnds(order[k], a, b);
+            int ra = findRoot(parent, a), rb = findRoot(parent, b);
+            if (ra == rb) continue;
+            parent[ra] = rb;
+            used[order[k]] = 1;
+        }
+    }
+    return used;
+}
+
+// `want` of the n candidates, evenly spaced (all of them if want <= 0).
+static vector<int> spreadPick(int n, int want) {
+    vector<int> picked;
+    if (want <= 0 || want >= n) {
+        for (int k = 0; k < n; k++) picked.push_back(k);
+        return picked;
+    }
+    for (int k = 0; k < want; k++) picked.push_back((int)((long long)k * n / want));
+    return picked;
+}
+
+// ----------------------------------------------------------------------------
+// GENERATE
+// ----------------------------------------------------------------------------
+static bool generateLevel(const GenOptions &opt) {
+    GenRandom rng;
+    rng.state = opt.seed;
+
+    // Margin of 2, a source stub on the left, a destination stub right/below
+    Lattice lat;
+    lat.spacing = opt.spacing;
+    lat.x0 = 2 + opt.spacing;
+    lat.y0 = 2;
+    lat.nx = (opt.cols - 2 - lat.x0 - opt.spacing) / opt.spacing + 1;
+    lat.ny = (opt.rows - 2 - lat.y0 - opt.spacing) / opt.spacing + 1;
+    if (lat.nx < 2 || lat.ny < 2) {
+        cout << "Error: " << opt.rows << "x" << opt.cols << " is too small for spacing " << opt.spacing << "\n";
+        return false;
+    }
+
+    vector<string> grid(opt.rows, string(opt.cols, '.'));
+    vector<char> used = chooseEdges(lat, opt.topology, rng);
+
+    for (int e = 0; e < lat.edgeCount(); e++) {
+        if (!used[e]) continue;
+        int a, b;
+        lat.edgeEnds(e, a, b);
+        int ax = lat.nodeX(a % lat.nx), ay = lat.nodeY(a / lat.nx);
+        int bx = lat.nodeX(b % lat.nx), by = lat.nodeY(b / lat.nx);
+        if (ay == by) {
+            for (int x = ax + 1; x < bx; x++) grid[ay][x] = '=';
+        } else {
+            for (int y = ay + 1; y < by; y++) grid[y][ax] = '|';
+        }
+    }
+    for (int j = 0; j < lat.ny; j++)
+        for (int i = 0; i < lat.nx; i++) grid[lat.nodeY(j)][lat.nodeX(i)] = '+';
+
+    // Sources off the left column, destinations off the right column and
+    // the bottom row
+    vector<Terminal> sources, dests;
+    vector<int> pick = spreadPick(lat.ny, opt.sources);
+    for (size_t k = 0; k < pick.size(); k++) {
+        int y = lat.nodeY(pick[k]);
+        for (int x = 3; x < lat.x0; x++) grid[y][x] = '=';
+        grid[y][2] = 'S';
+        Terminal t = {2, y};
+        sources.push_back(t);
+    }
+
+    int rightCount = lat.ny, bottomCount = lat.nx;
+    pick = spreadPick(rightCount + bottomCount, opt.dests);
+    for (size_t k = 0; k < pick.size(); k++) {
+        Terminal t;
+        if (pick[k] < rightCount) {
+            int y = lat.nodeY(pick[k]);
+            int xEnd = lat.nodeX(lat.nx - 1) + opt.spacing;
+            for (int x = lat.nodeX(lat.nx - 1) + 1; x < xEnd; x++) grid[y][x] = '=';
+            grid[y][xEnd] = 'D';
+            t.x = xEnd;
+            t.y = y;
+        } else {
+            int x = lat.nodeX(pick[k] - rightCount);
+            int yEnd = lat.nodeY(lat.ny - 1) + opt.spacing;
+            for (int y = lat.nodeY(lat.ny - 1) + 1; y < yEnd; y++) grid[y][x] = '|';
+            grid[yEnd][x] = 'D';
+            t.x = x;
+            t.y = yEnd;
+        }
+        dests.push_back(t);
+    }
+
+    FILE *f = (opt.outPath == "-") ? stdout : fopen(opt.outPath.c_str(), "w");
+    if (!f) {
+        cout << "Error: Cannot write " << opt.outPath << "\n";
+        return false;
+    }
+
+    fprintf(f, "NAME:\nGenerated %s %dx%d (seed %llu)\n\n", opt.topology.c_str(), opt.rows, opt.cols, opt.seed);
+    fprintf(f, "ROWS:\n%d\n\nCOLS:\n%d\n\nSEED:\n%d\n\nWEATHER:\nNORMAL\n\n", opt.rows, opt.cols,
+            (int)(opt.seed % 1000000) + 1);
+
+    // Switches are chosen before the map is written, as they draw on it
+    vector<int> switchNodes;
+    for (int n = 0; n < lat.nx * lat.ny; n++)
+        if (rng.unit() < opt.switchDensity) switchNodes.push_back(n);
+
+    static const char SWITCH_LETTERS[] = "ABCEFGHIJKLMNOPQRTUVWXYZ";
+    for (size_t s = 0; s < switchNodes.size(); s++) {
+        int n = switchNodes[s];
+        grid[lat.nodeY(n / lat.nx)][lat.nodeX(n % lat.nx)] = SWITCH_LETTERS[s % (sizeof(SWITCH_LETTERS) - 1)];
+    }
+
+    fprintf(f, "MAP:\n");
+    for (int r = 0; r < opt.rows; r++) {
+        fwrite(grid[r].data(), 1, grid[r].size(), f);
+        fputc('\n', f);
+    }
+
+    fprintf(f, "\nSWITCHES:\n");
+    for (size_t s = 0; s < switchNodes.size(); s++) {
+        int n = switchNodes[s];
+        bool global = rng.below(10) == 0;
+        int k = 2 + rng.below(4);
+        fprintf(f, "J%d %s 0 %d %d %d %d STRAIGHT TURN @%d,%d\n", (int)s, global ? "GLOBAL" : "PER_DIR",
+                k, k, k, k, lat.nodeX(n % lat.nx), lat.nodeY(n / lat.nx));
+    }
+
+    // Schedule sorted by spawn tick, like the shipped levels
+    vector<int> spawnTicks(opt.trains);
+    for (int i = 0; i < opt.trains; i++) spawnTicks[i] = (opt.span > 0) ? rng.below(opt.span) : 0;
+    sort(spawnTicks.begin(), spawnTicks.end());
+
+    fprintf(f, "\nTRAINS:\n");
+    for (int i = 0; i < opt.trains; i++) {
+        const Terminal &d = dests[rng.below((int)dests.size())];
+        fprintf(f, "%d %d %d %d %d\n", spawnTicks[i], d.x, d.y, 1 + rng.below(3), rng.below(10));
+    }
+
+    bool ok = (f == stdout) ? (fflush(f) == 0) : (fclose(f) == 0);
+    if (!ok) {
+        cout << "Error: Cannot write " << opt.outPath << "\n";
+        return false;
+    }
+    if (f != stdout) {
+        cout << "Wrote " << opt.outPath << ": " << opt.rows << "x" << opt.cols << " " << opt.topology << ", "
+             << lat.nx * lat.ny << " nodes, " << switchNodes.size() << " switches, " << sources.size()
+             << " sources, " << dests.size() << " destinations, " << opt.trains << " trains\n";
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// MAIN
+// ----------------------------------------------------------------------------
+static void printUsage(const char *prog) {
+    cout << "Usage: " << prog << " -o <out.lvl | -> [options]\n";
+    cout << " --rows N, --cols N      level size (default 200 x 400, at most 20000 each)\n";
+    cout << " --spacing N             tiles between junctions (default 4, at least 2)\n";
+    cout << " --topology T            grid | lattice | tree (default lattice)\n";
+    cout << " --switch-density F      share of junctions that are switches, 0..1 (default 0.3)\n";
+    cout << " --sources N, --dests N  number of S and D tiles (default 0: one per line end)\n";
+    cout << " --trains N              number of trains (default 100)\n";
+    cout << " --span N                spawn ticks are spread over 0..N-1 (default 200)\n";
+    cout << " --seed N                random seed (default 1)\n";
+}
+
+int main(int argc, char **argv) {
+    GenOptions opt;
+    opt.rows = 200;
+    opt.cols = 400;
+    opt.spacing = 4;
+    opt.topology = "lattice";
+    opt.switchDensity = 0.3;
+    opt.sources = 0;
+    opt.dests = 0;
+    opt.trains = 100;
+    opt.span = 200;
+    opt.seed = 1;
+
+    for (int a = 1; a < argc; a++) {
+        string arg = argv[a];
+        bool hasValue = a + 1 < argc;
+        if ((arg == "-o" || arg == "--out") && hasValue) opt.outPath = argv[++a];
+        else if (arg == "--rows" && hasValue) opt.rows = atoi(argv[++a]);
+        else if (arg == "--cols" && hasValue) opt.cols = atoi(argv[++a]);
+        else if (arg == "--spacing" && hasValue) opt.spacing = atoi(argv[++a]);
+        else if (arg == "--topology" && hasValue) opt.topology = argv[++a];
+        else if (arg == "--switch-density" && hasValue) opt.switchDensity = atof(argv[++a]);
+        else if (arg == "--sources" && hasValue) opt.sources = atoi(argv[++a]);
+        else if (arg == "--dests" && hasValue) opt.dests = atoi(argv[++a]);
+        else if (arg == "--trains" && hasValue) opt.trains = atoi(argv[++a]);
+        else if (arg == "--span" && hasValue) opt.span = atoi(argv[++a]);
+        else if (arg == "--seed" && hasValue) opt.seed = strtoull(argv[++a], NULL, 10);
+        else {
+            printUsage(argv[0]);
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+    }
+
+    if (opt.outPath.empty() || opt.rows <= 0 || opt.cols <= 0 || opt.rows > 20000 || opt.cols > 20000 ||
+        opt.spacing < 2 || opt.trains < 0 ||
+        (opt.topology != "grid" && opt.topology != "lattice" && opt.topology != "tree")) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    return generateLevel(opt) ? 0 : 1;
+}